@@ -0,0 +1,381 @@
+#ifndef BITSET_H
+#define BITSET_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Bitset: a growable array of bits packed into a Darray of 64 bit words, a
+ * flag costs one bit instead of the byte of a bool array. The bits past the
+ * length in the last word are always clear, so counting and scanning work a
+ * whole word at a time. The bulk operations, counting and scanning are
+ * compiled for AVX-512, AVX2 and baseline x86-64 and picked at load time like
+ * the Darray search functions, DARRAY_NO_SIMD turns that off.
+ *
+ *   Bitset visible = Bitset_create(n_entities);
+ *   Bitset_resize(&visible, n_entities);
+ *   Bitset_and(&visible, &in_frustum);
+ *   Bitset_for_each(&visible, entity) draw(entity);
+ */
+#define BITSET_NONE SIZE_MAX
+#define BITSET_WORD_BITS 64
+
+typedef struct Bitset
+{
+    uint64_t *words; // Darray, one element per started word
+    size_t length;   // in bits
+} Bitset;
+
+// capacity is in bits
+Bitset _Bitset_create(size_t capacity, void *(*allocator)(size_t),
+                      void *(*reallocator)(void *, size_t),
+                      void (*liberator)(void *));
+#define Bitset_create(capacity)                                                \
+    _Bitset_create(capacity, malloc, realloc, free)
+#define Bitset_create_allocator(capacity, malloc, realloc, free)               \
+    _Bitset_create(capacity, malloc, realloc, free)
+
+void Bitset_destroy(Bitset *self);
+
+size_t Bitset_length(Bitset *self);
+void Bitset_push(Bitset *self, bool value);
+// bits added at the end are clear
+void Bitset_resize(Bitset *self, size_t length);
+void Bitset_fill(Bitset *self, bool value);
+
+// in place word by word operations on bitsets of the same length, andnot
+// clears the bits of self that are set in other
+void Bitset_and(Bitset *self, const Bitset *other);
+void Bitset_or(Bitset *self, const Bitset *other);
+void Bitset_xor(Bitset *self, const Bitset *other);
+void Bitset_andnot(Bitset *self, const Bitset *other);
+
+// number of set bits
+size_t Bitset_count(const Bitset *self);
+// first set bit at or after from, BITSET_NONE when there is none
+size_t Bitset_find_next(const Bitset *self, size_t from);
+
+#define Bitset_for_each(self, index)                                           \
+    for (size_t index = Bitset_find_next(self, 0); index != BITSET_NONE;       \
+         index = Bitset_find_next(self, index + 1))
+
+// single bits, inline since they are a shift and a mask
+
+static inline bool Bitset_test(const Bitset *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index >= self->length)
+    {
+        printf("Bitset: refused to carry on with call to Bitset_test, index "
+               "overflows bitset length\n");
+        return false;
+    }
+#endif
+    return (self->words[index / BITSET_WORD_BITS] >>
+            (index % BITSET_WORD_BITS)) &
+           1;
+}
+
+static inline void Bitset_set(Bitset *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index >= self->length)
+    {
+        printf("Bitset: refused to carry on with call to Bitset_set, index "
+               "overflows bitset length\n");
+        return;
+    }
+#endif
+    self->words[index / BITSET_WORD_BITS] |= (uint64_t)1
+                                             << (index % BITSET_WORD_BITS);
+}
+
+static inline void Bitset_clear(Bitset *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index >= self->length)
+    {
+        printf("Bitset: refused to carry on with call to Bitset_clear, index "
+               "overflows bitset length\n");
+        return;
+    }
+#endif
+    self->words[index / BITSET_WORD_BITS] &=
+        ~((uint64_t)1 << (index % BITSET_WORD_BITS));
+}
+
+#endif // #ifndef BITSET_H
+
+#if defined(BITSET_INCLUDE_IMPLEMENTATION) &&                                  \
+    !defined(BITSET_IMPLEMENTATION_INCLUDED)
+#define BITSET_IMPLEMENTATION_INCLUDED
+
+#include <string.h>
+
+#define BITSET_INTERNAL static inline
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) &&         \
+    !defined(DARRAY_NO_SIMD)
+#define BITSET_SIMD_TARGETS                                                    \
+    __attribute__((                                                            \
+        target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+#define BITSET_SIMD_TARGETS
+#endif
+
+#ifdef DARRAY_NO_SIMD
+#define BITSET_SIMD_ENABLED 0
+#else
+#define BITSET_SIMD_ENABLED 1
+#endif
+
+// eight words, one AVX-512 register or two AVX2 registers
+#define BITSET_SIMD_WORDS 8
+
+typedef uint64_t BitsetVec
+    __attribute__((vector_size(BITSET_SIMD_WORDS * sizeof(uint64_t))));
+
+/* * * *   KERNELS   * * * */
+/* * * * (Internal) * * * */
+
+#define BITSET_AND(a, b) ((a) & (b))
+#define BITSET_OR(a, b) ((a) | (b))
+#define BITSET_XOR(a, b) ((a) ^ (b))
+#define BITSET_ANDNOT(a, b) ((a) & ~(b))
+
+#define BITSET_WORDS_OPERATION(name, OP)                                       \
+    BITSET_SIMD_TARGETS static void Bitset_##name##_words(                     \
+        uint64_t *self, const uint64_t *other, size_t n)                       \
+    {                                                                          \
+        size_t i = 0;                                                          \
+        for (; BITSET_SIMD_ENABLED && i + BITSET_SIMD_WORDS <= n;              \
+             i += BITSET_SIMD_WORDS)                                           \
+        {                                                                      \
+            BitsetVec a, b;                                                    \
+            memcpy(&a, self + i, sizeof a);                                    \
+            memcpy(&b, other + i, sizeof b);                                   \
+            a = OP(a, b);                                                      \
+            memcpy(self + i, &a, sizeof a);                                    \
+        }                                                                      \
+        for (; i < n; i++)                                                     \
+        {                                                                      \
+            self[i] = OP(self[i], other[i]);                                   \
+        }                                                                      \
+    }
+
+BITSET_WORDS_OPERATION(and, BITSET_AND)
+BITSET_WORDS_OPERATION(or, BITSET_OR)
+BITSET_WORDS_OPERATION(xor, BITSET_XOR)
+BITSET_WORDS_OPERATION(andnot, BITSET_ANDNOT)
+
+// the x86-64-v3 and v4 clones count with popcnt, the default one with bit
+// twiddling. Four sums keep four popcnts in flight.
+BITSET_SIMD_TARGETS static size_t Bitset_count_words(const uint64_t *words,
+                                                     size_t n)
+{
+    size_t sums[4] = {0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+    {
+        sums[0] += __builtin_popcountll(words[i]);
+        sums[1] += __builtin_popcountll(words[i + 1]);
+        sums[2] += __builtin_popcountll(words[i + 2]);
+        sums[3] += __builtin_popcountll(words[i + 3]);
+    }
+    for (; i < n; i++)
+    {
+        sums[0] += __builtin_popcountll(words[i]);
+    }
+    return sums[0] + sums[1] + sums[2] + sums[3];
+}
+
+// index of the first non zero word at or after i, n when there is none. Runs
+// of clear words are skipped eight at a time.
+BITSET_SIMD_TARGETS static size_t Bitset_next_word(const uint64_t *words,
+                                                   size_t i, size_t n)
+{
+    while (BITSET_SIMD_ENABLED && i + BITSET_SIMD_WORDS <= n)
+    {
+        BitsetVec block;
+        memcpy(&block, words + i, sizeof block);
+        if (block[0] | block[1] | block[2] | block[3] | block[4] | block[5] |
+            block[6] | block[7])
+        {
+            break;
+        }
+        i += BITSET_SIMD_WORDS;
+    }
+    while (i < n && words[i] == 0)
+    {
+        i++;
+    }
+    return i;
+}
+
+/* * * *    WORDS    * * * */
+/* * * * (Internal) * * * */
+
+BITSET_INTERNAL size_t Bitset_words_for(size_t length)
+{
+    return (length + BITSET_WORD_BITS - 1) / BITSET_WORD_BITS;
+}
+
+// clears the bits past the length in the last word
+BITSET_INTERNAL void Bitset_clear_tail(Bitset *self)
+{
+    size_t used = self->length % BITSET_WORD_BITS;
+    if (used != 0)
+    {
+        self->words[self->length / BITSET_WORD_BITS] &=
+            ((uint64_t)1 << used) - 1;
+    }
+}
+
+BITSET_INTERNAL bool Bitset_same_length(Bitset *self, const Bitset *other,
+                                        const char *function)
+{
+#ifdef DARRAY_DEBUG
+    if (self->length != other->length)
+    {
+        printf("Bitset: refused to carry on with call to %s, bitsets have "
+               "different lengths\n",
+               function);
+        return false;
+    }
+#endif
+    return true;
+}
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+Bitset _Bitset_create(size_t capacity, void *(*allocator)(size_t),
+                      void *(*reallocator)(void *, size_t),
+                      void (*liberator)(void *))
+{
+    Bitset result = {
+        .words = _Darray_create(sizeof(uint64_t), Bitset_words_for(capacity),
+                                allocator, reallocator, liberator),
+        .length = 0,
+    };
+    return result;
+}
+
+void Bitset_destroy(Bitset *self)
+{
+    Darray_destroy(self->words);
+    memset(self, 0, sizeof(Bitset));
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+size_t Bitset_length(Bitset *self)
+{
+    return self->length;
+}
+
+void Bitset_push(Bitset *self, bool value)
+{
+    if (self->length % BITSET_WORD_BITS == 0)
+    {
+        Darray_push(&self->words, (uint64_t)0);
+    }
+    self->words[self->length / BITSET_WORD_BITS] |=
+        (uint64_t)value << (self->length % BITSET_WORD_BITS);
+    self->length += 1;
+}
+
+void Bitset_resize(Bitset *self, size_t length)
+{
+    size_t old_words = Darray_length(self->words);
+    size_t new_words = Bitset_words_for(length);
+    if (new_words > old_words)
+    {
+        _Darray_make_room((void **)&self->words, new_words - old_words);
+        memset(self->words + old_words, 0,
+               (new_words - old_words) * sizeof(uint64_t));
+    }
+    (GET_SELF((void *)self->words))->n_elements = new_words;
+    DARRAY_STATS_LENGTH(GET_SELF((void *)self->words), new_words);
+    self->length = length;
+    Bitset_clear_tail(self);
+}
+
+void Bitset_fill(Bitset *self, bool value)
+{
+    memset(self->words, value ? 0xff : 0,
+           Darray_length(self->words) * sizeof(uint64_t));
+    Bitset_clear_tail(self);
+}
+
+/* * * * BULK OPERATIONS * * * */
+
+void Bitset_and(Bitset *self, const Bitset *other)
+{
+    if (Bitset_same_length(self, other, "Bitset_and"))
+    {
+        Bitset_and_words(self->words, other->words,
+                         Darray_length(self->words));
+    }
+}
+
+void Bitset_or(Bitset *self, const Bitset *other)
+{
+    if (Bitset_same_length(self, other, "Bitset_or"))
+    {
+        Bitset_or_words(self->words, other->words, Darray_length(self->words));
+    }
+}
+
+void Bitset_xor(Bitset *self, const Bitset *other)
+{
+    if (Bitset_same_length(self, other, "Bitset_xor"))
+    {
+        Bitset_xor_words(self->words, other->words,
+                         Darray_length(self->words));
+    }
+}
+
+void Bitset_andnot(Bitset *self, const Bitset *other)
+{
+    if (Bitset_same_length(self, other, "Bitset_andnot"))
+    {
+        Bitset_andnot_words(self->words, other->words,
+                            Darray_length(self->words));
+    }
+}
+
+/* * * * SEARCH * * * */
+
+size_t Bitset_count(const Bitset *self)
+{
+    return Bitset_count_words(self->words, Darray_length(self->words));
+}
+
+// the first word is masked below from, the rest are scanned whole
+size_t Bitset_find_next(const Bitset *self, size_t from)
+{
+    if (from >= self->length)
+    {
+        return BITSET_NONE;
+    }
+    size_t n = Darray_length(self->words);
+    size_t i = from / BITSET_WORD_BITS;
+    uint64_t word =
+        self->words[i] & (~(uint64_t)0 << (from % BITSET_WORD_BITS));
+    if (word == 0)
+    {
+        i = Bitset_next_word(self->words, i + 1, n);
+        if (i == n)
+        {
+            return BITSET_NONE;
+        }
+        word = self->words[i];
+    }
+    return i * BITSET_WORD_BITS + __builtin_ctzll(word);
+}
+
+#endif // #if defined(BITSET_INCLUDE_IMPLEMENTATION)
@@ -55,6 +55,8 @@ typedef struct Darray
     size_t element_size;
     size_t capacity;
     size_t reserve_space;
+    size_t front_space;
+    size_t flags;
 
     malloc_t allocator;
     realloc_t reallocator;
@@ -73,6 +75,21 @@ void *_Darray_create(size_t element_size, size_t initial_capacity,
     _Darray_create(sizeof(type), capacity, _buildless_malloc,                  \
                    _buildless_realloc, _buildless_free)
 
+#define DARRAY_FLAG_BORROWED ((size_t)1 << 0)
+
+void *_Darray_create_buffer(size_t element_size, void *buffer,
+                            size_t buffer_size, malloc_t allocator,
+                            realloc_t reallocator, free_t liberator);
+#define DARRAY_BUFFER_SIZE(type, n) (sizeof(Darray) + (n) * sizeof(type))
+// lives in the enclosing block until it outgrows n elements
+#define Darray_create_stack(type, n)                                           \
+    _Darray_create_buffer(                                                     \
+        sizeof(type),                                                          \
+        (max_align_t[(DARRAY_BUFFER_SIZE(type, n) + sizeof(max_align_t) - 1) / \
+                     sizeof(max_align_t)]){0},                                 \
+        DARRAY_BUFFER_SIZE(type, n), _buildless_malloc, _buildless_realloc,    \
+        _buildless_free)
+
 void Darray_destroy(void *data);
 
 void _Darray_push(void **, void *);
@@ -192,6 +209,26 @@ void *_Darray_create(size_t element_size, size_t initial_capacity,
     self->element_size = element_size;
     self->capacity = initial_capacity;
     self->reserve_space = initial_capacity;
+    self->front_space = 0;
+    self->flags = 0;
+    self->allocator = allocator;
+    self->reallocator = reallocator;
+    self->liberator = liberator;
+
+    return GET_DATA(self);
+}
+
+void *_Darray_create_buffer(size_t element_size, void *buffer,
+                            size_t buffer_size, malloc_t allocator,
+                            realloc_t reallocator, free_t liberator)
+{
+    Darray *self = buffer;
+    self->n_elements = 0;
+    self->element_size = element_size;
+    self->capacity = (buffer_size - sizeof(Darray)) / element_size;
+    self->reserve_space = self->capacity;
+    self->front_space = 0;
+    self->flags = DARRAY_FLAG_BORROWED;
     self->allocator = allocator;
     self->reallocator = reallocator;
     self->liberator = liberator;
@@ -202,6 +239,10 @@ void *_Darray_create(size_t element_size, size_t initial_capacity,
 void Darray_destroy(void *data)
 {
     Darray *self = GET_SELF(data);
+    if (self->flags & DARRAY_FLAG_BORROWED)
+    {
+        return;
+    }
     self->liberator(self);
 }
 
@@ -211,32 +252,58 @@ size_t Darray_length(void *data)
     return self->n_elements;
 }
 
+static inline void Darray_realloc(Darray **self_p, void **data_p,
+                                  size_t new_capacity)
+{
+    Darray *self = *self_p;
+    size_t size = sizeof(Darray) + new_capacity * self->element_size;
+    if (self->flags & DARRAY_FLAG_BORROWED)
+    {
+        Darray *moved = self->allocator(size);
+        memcpy(moved, self,
+               sizeof(Darray) + self->n_elements * self->element_size);
+        moved->flags &= ~DARRAY_FLAG_BORROWED;
+        self = moved;
+    }
+    else
+    {
+        self = self->reallocator(self, size);
+    }
+    self->capacity = new_capacity;
+    (*self_p) = self;
+    (*data_p) = GET_DATA(self);
+}
+
 static inline void Darray_check_full_and_resize(Darray **self_p, void **data_p,
                                                 size_t offset)
 {
     Darray *const self = *self_p;
     if (self->n_elements + offset >= self->capacity)
     {
-        for (size_t i = 0; self->n_elements + offset >= self->capacity; i++)
+        size_t new_capacity = self->capacity == 0 ? 1 : self->capacity;
+        while (self->n_elements + offset >= new_capacity)
         {
-            self->capacity *= 2;
+            new_capacity *= 2;
         }
-        (*self_p) = self->reallocator(
-            self, self->capacity * self->element_size + sizeof(Darray));
-        (*data_p) = GET_DATA(self);
+        Darray_realloc(self_p, data_p, new_capacity);
     }
 }
 
+// shrinks at a quarter, to a half, never below the reserved space, the
+// caller's buffer of a borrowed array is never given up for the heap
 static inline void
 Darray_check_underused_and_resize(Darray **self_p, void **data_p, size_t offset)
 {
     Darray *const self = *self_p;
-    if (self->n_elements - offset >= self->capacity / 4 &&
-        self->reserve_space >= self->capacity / 2)
+    if (self->flags & DARRAY_FLAG_BORROWED)
     {
-        (*self_p) = self->reallocator(
-            self, self->capacity * self->element_size + sizeof(Darray));
-        (*data_p) = GET_DATA(self);
+        return;
+    }
+    size_t new_capacity = self->capacity / 2;
+    if (self->n_elements - offset <= self->capacity / 4 &&
+        new_capacity >= self->reserve_space && new_capacity > 0)
+    {
+        Darray_realloc(self_p, data_p, new_capacity);
     }
 }
 
@@ -395,21 +462,33 @@ static inline void _buildless_clean_memory()
 
 // string utils
 
+// copies string to end and terminates it, returns the new end so pieces are
+// appended in linear time instead of rescanning the result like strcat
+static inline char *_buildless_str_append(char *end, const char *string)
+{
+    size_t size = strlen(string);
+    memcpy(end, string, size + 1);
+    return end + size;
+}
+
 // allocates result
 char *str_join(char **str_arr)
 {
-    size_t str_size = 0;
+    size_t str_size = 1;
     for (size_t i = 0; i < Darray_length(str_arr); i += 1)
     {
         str_size += strlen(str_arr[i]) + 1;
     }
     char *result = _buildless_malloc(str_size);
-    *result = 0;
-    strcat(result, str_arr[0]);
-    for (size_t i = 1; i < Darray_length(str_arr); i += 1)
+    char *end = result;
+    *end = 0;
+    for (size_t i = 0; i < Darray_length(str_arr); i += 1)
     {
-        strcat(result, " ");
-        strcat(result, str_arr[i]);
+        if (i > 0)
+        {
+            end = _buildless_str_append(end, " ");
+        }
+        end = _buildless_str_append(end, str_arr[i]);
     }
     return result;
 }
@@ -528,21 +607,23 @@ char **str_split(const char *string, char c)
 #define str_concat(...) _str_concat_va(__VA_ARGS__, NULL)
 const char *_str_concat_va(const char *first, ...)
 {
-    size_t allocated_size = 512;
-    char *result = _buildless_malloc(512 * sizeof *result);
-    *result = 0;
+    // measures every piece first so the result is allocated once
     va_list args;
     va_start(args, first);
-    size_t total_string_size = 0;
-    for (const char *s = first; s != NULL; s = va_arg(args, const char *))
+    va_list sizes;
+    va_copy(sizes, args);
+    size_t total_string_size = 1;
+    for (const char *s = first; s != NULL; s = va_arg(sizes, const char *))
     {
         total_string_size += strlen(s);
-        while (total_string_size > allocated_size)
-        {
-            allocated_size *= 2;
-        }
-        result = _buildless_realloc(result, allocated_size * sizeof *result);
-        strcat(result, s);
+    }
+    va_end(sizes);
+    char *result = _buildless_malloc(total_string_size * sizeof *result);
+    char *end = result;
+    *end = 0;
+    for (const char *s = first; s != NULL; s = va_arg(args, const char *))
+    {
+        end = _buildless_str_append(end, s);
     }
     va_end(args);
     /* gc_add(result); */
@@ -584,8 +665,8 @@ bool generic_cmp(const char *generic, const char *string, char ***matches_out)
             *matches_out = NULL;
         return false;
     }
-    size_t *start_indices = Darray_create(size_t, 16);
-    size_t *end_indices = Darray_create(size_t, 16);
+    size_t *start_indices = Darray_create_stack(size_t, 16);
+    size_t *end_indices = Darray_create_stack(size_t, 16);
     const char *s = string;
     for (size_t i = 0; i < Darray_length(split); i += 1)
     {
@@ -656,16 +737,17 @@ const char *generic_to_literal(const char *generic, char **matches)
     {
         matches_total_size += strlen(matches[i]);
     }
-    char *result = _buildless_malloc((strlen(generic) + matches_total_size) *
-                                     sizeof *result);
-    *result = 0;
+    char *result = _buildless_malloc(
+        (strlen(generic) + matches_total_size + 1) * sizeof *result);
+    char *end = result;
+    *end = 0;
     char **split = str_split(generic, '@');
     for (size_t i = 0; i < Darray_length(matches); i += 1)
     {
-        strcat(result, split[i]);
-        strcat(result, matches[i]);
+        end = _buildless_str_append(end, split[i]);
+        end = _buildless_str_append(end, matches[i]);
     }
-    strcat(result, split[Darray_length(split) - 1]);
+    _buildless_str_append(end, split[Darray_length(split) - 1]);
     Darray_destroy(indices);
     DARRAY_FREE_ALL(split);
     return result;
@@ -714,11 +796,12 @@ void _buildless_init(int argc, const char **argv, const char *file)
             str_size += strlen(argv[i]) + 1;
         }
         char *args = _buildless_malloc((str_size + 1) * sizeof *args);
-        *args = 0;
+        char *end = args;
+        *end = 0;
         for (int i = 0; i < argc; i += 1)
         {
-            strcat(args, argv[i]);
-            strcat(args, " ");
+            end = _buildless_str_append(end, argv[i]);
+            end = _buildless_str_append(end, " ");
         }
         command_va("%s %s -o %s", COMPILER, file, exec_name);
         command_va("%s --force %s", exec_name, args);
@@ -884,12 +967,13 @@ char **listdir_r(const char *dir_path)
     }
     for (size_t i = 0; i < Darray_length(ls); i += 1)
     {
-        new_path = _buildless_malloc((strlen(dir_path) + strlen(ls[i]) + 1) *
-                                     sizeof *new_path);
-        *new_path = 0;
-        strcat(new_path, dir_path);
-        strcat(new_path, DIR_DIVISOR_CHAR_STR);
-        strcat(new_path, ls[i]);
+        new_path = _buildless_malloc(
+            (strlen(dir_path) + strlen(DIR_DIVISOR_CHAR_STR) + strlen(ls[i]) +
+             1) *
+            sizeof *new_path);
+        char *end = _buildless_str_append(new_path, dir_path);
+        end = _buildless_str_append(end, DIR_DIVISOR_CHAR_STR);
+        _buildless_str_append(end, ls[i]);
         if (is_dir(new_path) == 1)
         {
             char **ls_r = listdir_r(new_path);
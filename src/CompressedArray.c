@@ -0,0 +1,446 @@
+#ifndef COMPRESSED_ARRAY_H
+#define COMPRESSED_ARRAY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Compressed array: an append only array of 64 bit integers stored in
+ * blocks of 128 bit packed values, for sorted or clustered data where most
+ * of the bits are redundant. Every block is encoded the smaller of two ways:
+ *
+ *   frame of reference: value - minimum of the block
+ *   delta:              value - value four places earlier, for blocks that
+ *                       never decrease
+ *
+ * in as many bits as the largest encoded value needs. The values are dealt
+ * round robin to four lanes and every lane is packed into its own stream of
+ * words, the streams interleaved word by word, so four values are unpacked
+ * with one vector shift and mask and delta blocks are summed four lanes at a
+ * time. A block index gives random access, the last incomplete block is kept
+ * unpacked so appending is O(1) amortized.
+ *
+ * Sorted ids 1000 apart take 12 bits per value instead of 64, a little under
+ * 14 with the block index.
+ */
+#define COMPRESSED_ARRAY_BLOCK 128
+#define COMPRESSED_ARRAY_LANES 4
+
+typedef struct CompressedArrayBlock
+{
+    uint64_t base;  // the minimum, or the first value of a delta block
+    size_t offset;  // index of the first packed word of the block
+    uint8_t width;  // bits per encoded value, 0 to 64
+    uint8_t delta;  // encoded as differences
+} CompressedArrayBlock;
+
+typedef struct CompressedArray
+{
+    uint64_t *words;              // Darray of packed blocks
+    CompressedArrayBlock *blocks; // Darray, one per full block
+    uint64_t *tail;               // Darray of the values not packed yet
+    size_t length;
+} CompressedArray;
+
+CompressedArray _CompressedArray_create(void *(*allocator)(size_t),
+                                        void *(*reallocator)(void *, size_t),
+                                        void (*liberator)(void *));
+#define CompressedArray_create()                                               \
+    _CompressedArray_create(malloc, realloc, free)
+#define CompressedArray_create_allocator(malloc, realloc, free)                \
+    _CompressedArray_create(malloc, realloc, free)
+
+// compresses a Darray of uint32_t or uint64_t, data is left untouched, any
+// other element size is refused and gives an empty array
+CompressedArray _CompressedArray_from_Darray(
+    void *data, void *(*allocator)(size_t),
+    void *(*reallocator)(void *, size_t), void (*liberator)(void *));
+#define CompressedArray_from_Darray(data)                                      \
+    _CompressedArray_from_Darray(data, malloc, realloc, free)
+
+void CompressedArray_destroy(CompressedArray *self);
+
+size_t CompressedArray_length(CompressedArray *self);
+// bytes held by the array
+size_t CompressedArray_size(CompressedArray *self);
+
+void CompressedArray_push(CompressedArray *self, uint64_t value);
+uint64_t CompressedArray_get(CompressedArray *self, size_t index);
+// writes the values in [start, start + n) to out, whole blocks are unpacked
+// straight into out
+void CompressedArray_decode(CompressedArray *self, size_t start, size_t n,
+                            uint64_t *out);
+// decompresses everything into a new Darray of uint64_t, on the allocator
+// the compressed array was created with
+uint64_t *CompressedArray_to_Darray(CompressedArray *self);
+
+#endif // #ifndef COMPRESSED_ARRAY_H
+
+#if defined(COMPRESSED_ARRAY_INCLUDE_IMPLEMENTATION) &&                        \
+    !defined(COMPRESSED_ARRAY_IMPLEMENTATION_INCLUDED)
+#define COMPRESSED_ARRAY_IMPLEMENTATION_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+
+#define COMPRESSED_ARRAY_INTERNAL static inline
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) &&         \
+    !defined(DARRAY_NO_SIMD)
+#define COMPRESSED_ARRAY_SIMD_TARGETS                                          \
+    __attribute__((                                                            \
+        target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+#define COMPRESSED_ARRAY_SIMD_TARGETS
+#endif
+
+// values per lane, and the most packed words a block can take
+#define COMPRESSED_ARRAY_STEPS (COMPRESSED_ARRAY_BLOCK / COMPRESSED_ARRAY_LANES)
+#define COMPRESSED_ARRAY_MAX_WORDS COMPRESSED_ARRAY_BLOCK
+
+// one value of every lane, an AVX2 register
+typedef uint64_t CompressedArrayVec
+    __attribute__((vector_size(COMPRESSED_ARRAY_LANES * sizeof(uint64_t))));
+
+/* * * *   PACKING   * * * */
+/* * * * (Internal) * * * */
+
+COMPRESSED_ARRAY_INTERNAL uint64_t CompressedArray_mask(size_t width)
+{
+    return width == 64 ? ~(uint64_t)0 : ((uint64_t)1 << width) - 1;
+}
+
+COMPRESSED_ARRAY_INTERNAL size_t CompressedArray_width(uint64_t max)
+{
+    return max == 0 ? 0 : 64 - __builtin_clzll(max);
+}
+
+// every lane holds 32 values of width bits, rounded up to whole words
+COMPRESSED_ARRAY_INTERNAL size_t CompressedArray_block_words(size_t width)
+{
+    return (width * COMPRESSED_ARRAY_STEPS + 63) / 64 * COMPRESSED_ARRAY_LANES;
+}
+
+// value step * 4 + lane sits at bit step * width of the stream of its lane,
+// word w of lane l is words[w * 4 + l]. A value that crosses a word boundary
+// continues in the next word of the same lane.
+COMPRESSED_ARRAY_SIMD_TARGETS static void
+CompressedArray_pack(const uint64_t *encoded, size_t width, uint64_t *words)
+{
+    if (width == 0)
+    {
+        return;
+    }
+    memset(words, 0, CompressedArray_block_words(width) * sizeof(uint64_t));
+    for (size_t step = 0; step < COMPRESSED_ARRAY_STEPS; step++)
+    {
+        size_t bit = step * width;
+        uint64_t *low = words + bit / 64 * COMPRESSED_ARRAY_LANES;
+        size_t shift = bit % 64;
+        CompressedArrayVec values, packed;
+        memcpy(&values, encoded + step * COMPRESSED_ARRAY_LANES,
+               sizeof values);
+        memcpy(&packed, low, sizeof packed);
+        packed |= values << shift;
+        memcpy(low, &packed, sizeof packed);
+        if (shift + width > 64)
+        {
+            uint64_t *high = low + COMPRESSED_ARRAY_LANES;
+            memcpy(&packed, high, sizeof packed);
+            packed |= values >> (64 - shift);
+            memcpy(high, &packed, sizeof packed);
+        }
+    }
+}
+
+COMPRESSED_ARRAY_SIMD_TARGETS static void
+CompressedArray_unpack(const uint64_t *words, CompressedArrayBlock block,
+                       uint64_t *out)
+{
+    size_t width = block.width;
+    if (width == 0)
+    {
+        for (size_t i = 0; i < COMPRESSED_ARRAY_BLOCK; i++)
+        {
+            out[i] = block.base;
+        }
+        return;
+    }
+    uint64_t mask = CompressedArray_mask(width);
+    CompressedArrayVec sum = {block.base, block.base, block.base, block.base};
+    CompressedArrayVec base = sum;
+    for (size_t step = 0; step < COMPRESSED_ARRAY_STEPS; step++)
+    {
+        size_t bit = step * width;
+        const uint64_t *low = words + bit / 64 * COMPRESSED_ARRAY_LANES;
+        size_t shift = bit % 64;
+        CompressedArrayVec values, high;
+        memcpy(&values, low, sizeof values);
+        values >>= shift;
+        if (shift + width > 64)
+        {
+            memcpy(&high, low + COMPRESSED_ARRAY_LANES, sizeof high);
+            values |= high << (64 - shift);
+        }
+        values &= mask;
+        // delta blocks keep a running sum per lane
+        sum = block.delta ? sum + values : base + values;
+        memcpy(out + step * COMPRESSED_ARRAY_LANES, &sum, sizeof sum);
+    }
+}
+
+COMPRESSED_ARRAY_INTERNAL uint64_t CompressedArray_extract(
+    const uint64_t *words, size_t width, size_t step, size_t lane)
+{
+    size_t bit = step * width;
+    const uint64_t *low = words + bit / 64 * COMPRESSED_ARRAY_LANES + lane;
+    size_t shift = bit % 64;
+    uint64_t value = *low >> shift;
+    if (shift + width > 64)
+    {
+        value |= low[COMPRESSED_ARRAY_LANES] << (64 - shift);
+    }
+    return value & CompressedArray_mask(width);
+}
+
+// encodes 128 values and appends them as a block
+COMPRESSED_ARRAY_INTERNAL void
+CompressedArray_push_block(CompressedArray *self, const uint64_t *values)
+{
+    uint64_t min = values[0], max = values[0];
+    uint64_t max_delta = 0;
+    bool sorted = true;
+    for (size_t i = 1; i < COMPRESSED_ARRAY_BLOCK; i++)
+    {
+        min = values[i] < min ? values[i] : min;
+        max = values[i] > max ? values[i] : max;
+        sorted &= values[i] >= values[i - 1];
+    }
+    uint64_t encoded[COMPRESSED_ARRAY_BLOCK];
+    if (sorted)
+    {
+        for (size_t i = 0; i < COMPRESSED_ARRAY_BLOCK; i++)
+        {
+            uint64_t previous = i < COMPRESSED_ARRAY_LANES
+                                  ? min
+                                  : values[i - COMPRESSED_ARRAY_LANES];
+            encoded[i] = values[i] - previous;
+            max_delta = encoded[i] > max_delta ? encoded[i] : max_delta;
+        }
+    }
+    CompressedArrayBlock block = {
+        .base = min,
+        .offset = Darray_length(self->words),
+        .width = CompressedArray_width(max - min),
+        .delta = false,
+    };
+    if (sorted && CompressedArray_width(max_delta) < block.width)
+    {
+        block.width = CompressedArray_width(max_delta);
+        block.delta = true;
+    }
+    else
+    {
+        for (size_t i = 0; i < COMPRESSED_ARRAY_BLOCK; i++)
+        {
+            encoded[i] = values[i] - min;
+        }
+    }
+    uint64_t packed[COMPRESSED_ARRAY_MAX_WORDS];
+    CompressedArray_pack(encoded, block.width, packed);
+    _Darray_push_multiple((void **)&self->words, packed,
+                          CompressedArray_block_words(block.width));
+    Darray_push(&self->blocks, block);
+}
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+CompressedArray _CompressedArray_create(void *(*allocator)(size_t),
+                                        void *(*reallocator)(void *, size_t),
+                                        void (*liberator)(void *))
+{
+    CompressedArray result = {
+        .words = _Darray_create(sizeof(uint64_t), COMPRESSED_ARRAY_MAX_WORDS,
+                                allocator, reallocator, liberator),
+        .blocks = _Darray_create(sizeof(CompressedArrayBlock), 4, allocator,
+                                 reallocator, liberator),
+        .tail = _Darray_create(sizeof(uint64_t), COMPRESSED_ARRAY_BLOCK,
+                               allocator, reallocator, liberator),
+        .length = 0,
+    };
+    return result;
+}
+
+// whole blocks are encoded straight from data, the rest goes to the tail
+CompressedArray _CompressedArray_from_Darray(
+    void *data, void *(*allocator)(size_t),
+    void *(*reallocator)(void *, size_t), void (*liberator)(void *))
+{
+    CompressedArray result =
+        _CompressedArray_create(allocator, reallocator, liberator);
+    size_t element_size = (GET_SELF(data))->element_size;
+    // checked in every build, any other width would be read as garbage
+    if (element_size != sizeof(uint32_t) && element_size != sizeof(uint64_t))
+    {
+        printf("CompressedArray: refused to carry on with call to "
+               "CompressedArray_from_Darray, elements are not 32 or 64 bit "
+               "integers\n");
+        return result;
+    }
+    size_t n = Darray_length(data);
+    uint64_t values[COMPRESSED_ARRAY_BLOCK];
+    for (size_t start = 0; start < n; start += COMPRESSED_ARRAY_BLOCK)
+    {
+        size_t count = n - start < COMPRESSED_ARRAY_BLOCK
+                           ? n - start
+                           : COMPRESSED_ARRAY_BLOCK;
+        for (size_t i = 0; i < count; i++)
+        {
+            values[i] = element_size == sizeof(uint32_t)
+                            ? ((uint32_t *)data)[start + i]
+                            : ((uint64_t *)data)[start + i];
+        }
+        if (count == COMPRESSED_ARRAY_BLOCK)
+        {
+            CompressedArray_push_block(&result, values);
+        }
+        else
+        {
+            _Darray_push_multiple((void **)&result.tail, values, count);
+        }
+        result.length += count;
+    }
+    return result;
+}
+
+void CompressedArray_destroy(CompressedArray *self)
+{
+    Darray_destroy(self->words);
+    Darray_destroy(self->blocks);
+    Darray_destroy(self->tail);
+    memset(self, 0, sizeof(CompressedArray));
+}
+
+/* * * * GETTERS * * * */
+
+size_t CompressedArray_length(CompressedArray *self)
+{
+    return self->length;
+}
+
+size_t CompressedArray_size(CompressedArray *self)
+{
+    return sizeof(CompressedArray) +
+           Darray_length(self->words) * sizeof(uint64_t) +
+           Darray_length(self->blocks) * sizeof(CompressedArrayBlock) +
+           Darray_length(self->tail) * sizeof(uint64_t);
+}
+
+// a delta block sums the lane of the value up to it
+uint64_t CompressedArray_get(CompressedArray *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index >= self->length)
+    {
+        printf("CompressedArray: refused to carry on with call to "
+               "CompressedArray_get, index overflows array length\n");
+        return 0;
+    }
+#endif
+    size_t packed = Darray_length(self->blocks) * COMPRESSED_ARRAY_BLOCK;
+    if (index >= packed)
+    {
+        return self->tail[index - packed];
+    }
+    CompressedArrayBlock block =
+        self->blocks[index / COMPRESSED_ARRAY_BLOCK];
+    const uint64_t *words = self->words + block.offset;
+    size_t step = index % COMPRESSED_ARRAY_BLOCK / COMPRESSED_ARRAY_LANES;
+    size_t lane = index % COMPRESSED_ARRAY_LANES;
+    if (block.width == 0)
+    {
+        return block.base;
+    }
+    if (!block.delta)
+    {
+        return block.base +
+               CompressedArray_extract(words, block.width, step, lane);
+    }
+    uint64_t result = block.base;
+    for (size_t i = 0; i <= step; i++)
+    {
+        result += CompressedArray_extract(words, block.width, i, lane);
+    }
+    return result;
+}
+
+/* * * * DECODING * * * */
+
+void CompressedArray_decode(CompressedArray *self, size_t start, size_t n,
+                            uint64_t *out)
+{
+#ifdef DARRAY_DEBUG
+    if (start + n > self->length)
+    {
+        printf("CompressedArray: refused to carry on with call to "
+               "CompressedArray_decode, range overflows array length\n");
+        return;
+    }
+#endif
+    size_t packed = Darray_length(self->blocks) * COMPRESSED_ARRAY_BLOCK;
+    uint64_t buffer[COMPRESSED_ARRAY_BLOCK];
+    while (n > 0 && start < packed)
+    {
+        CompressedArrayBlock block =
+            self->blocks[start / COMPRESSED_ARRAY_BLOCK];
+        size_t skip = start % COMPRESSED_ARRAY_BLOCK;
+        size_t count = COMPRESSED_ARRAY_BLOCK - skip;
+        count = count < n ? count : n;
+        if (count == COMPRESSED_ARRAY_BLOCK)
+        {
+            CompressedArray_unpack(self->words + block.offset, block, out);
+        }
+        else
+        {
+            CompressedArray_unpack(self->words + block.offset, block, buffer);
+            memcpy(out, buffer + skip, count * sizeof(uint64_t));
+        }
+        start += count;
+        out += count;
+        n -= count;
+    }
+    if (n > 0)
+    {
+        memcpy(out, self->tail + (start - packed), n * sizeof(uint64_t));
+    }
+}
+
+uint64_t *CompressedArray_to_Darray(CompressedArray *self)
+{
+    Darray *words = GET_SELF((void *)self->words);
+    uint64_t *result =
+        Darray_create_allocator(uint64_t, self->length + 1, words->allocator,
+                                words->reallocator, words->liberator);
+    CompressedArray_decode(self, 0, self->length, result);
+    (GET_SELF((void *)result))->n_elements = self->length;
+    DARRAY_STATS_LENGTH(GET_SELF((void *)result), self->length);
+    return result;
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+// the tail is packed as soon as it makes a whole block
+void CompressedArray_push(CompressedArray *self, uint64_t value)
+{
+    Darray_push(&self->tail, value);
+    self->length += 1;
+    if (Darray_length(self->tail) == COMPRESSED_ARRAY_BLOCK)
+    {
+        CompressedArray_push_block(self, self->tail);
+        (GET_SELF((void *)self->tail))->n_elements = 0;
+    }
+}
+
+#endif // #if defined(COMPRESSED_ARRAY_INCLUDE_IMPLEMENTATION)
@@ -0,0 +1,307 @@
+#ifndef CONCURRENT_ARRAY_H
+#define CONCURRENT_ARRAY_H
+
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Append only array for many producer threads. A push reserves its slots
+ * with one atomic fetch-add on the length and then copies without any lock.
+ * Storage is segmented like SegmentedArray, segment k holds first << k
+ * elements: the first thread to reach a new segment claims it with a
+ * compare-and-swap and allocates it while the others wait, once per segment.
+ * Growth never moves an element that was already written. Threads that push
+ * many small elements should go through a ConcurrentArrayWriter, which
+ * batches them into one reservation.
+ *
+ * The length counts reserved slots. An element can be read once the call
+ * that pushed it has returned and the reader synchronized with the pushing
+ * thread, for example by joining it.
+ */
+#define CONCURRENT_ARRAY_MAX_SEGMENTS 64
+#define CONCURRENT_ARRAY_CACHE_LINE 64
+
+typedef struct ConcurrentArray
+{
+    // the hot counter does not share a cache line with the directory, the
+    // allocator hook only promises malloc alignment so padding is used
+    atomic_size_t n_elements;
+    char padding[CONCURRENT_ARRAY_CACHE_LINE - sizeof(atomic_size_t)];
+    void *_Atomic segments[CONCURRENT_ARRAY_MAX_SEGMENTS];
+    size_t element_size;
+    size_t first_shift;
+
+    void *(*allocator)(size_t);
+    void (*liberator)(void *);
+} ConcurrentArray;
+
+// first_capacity is rounded up to a power of two
+ConcurrentArray *_ConcurrentArray_create(size_t element_size,
+                                         size_t first_capacity,
+                                         void *(*allocator)(size_t),
+                                         void (*liberator)(void *));
+#define ConcurrentArray_create(type, first_capacity)                           \
+    _ConcurrentArray_create(sizeof(type), first_capacity, malloc, free)
+#define ConcurrentArray_create_allocator(type, first_capacity, malloc, free)   \
+    _ConcurrentArray_create(sizeof(type), first_capacity, malloc, free)
+
+// no push may be running
+void ConcurrentArray_destroy(ConcurrentArray *self);
+
+size_t ConcurrentArray_length(ConcurrentArray *self);
+void *ConcurrentArray_get(ConcurrentArray *self, size_t index);
+
+// both return the index of the first pushed element
+size_t _ConcurrentArray_push(ConcurrentArray *self, void *element);
+#define ConcurrentArray_push(self, element)                                    \
+    {                                                                          \
+        __auto_type ConcurrentArray_push_temp_var = element;                   \
+        _ConcurrentArray_push(self, &ConcurrentArray_push_temp_var);           \
+    }
+size_t ConcurrentArray_push_multiple(ConcurrentArray *self, void *array,
+                                     size_t n);
+
+// allocates a new Darray with a copy of the elements, no push may be running
+void *ConcurrentArray_to_Darray(ConcurrentArray *self);
+
+/*
+ * Per thread batching: a writer collects elements in a local buffer and
+ * pushes them with a single reservation when the buffer is full or on flush.
+ * Elements are only in the array after the flush, which must happen before
+ * the writer goes out of scope.
+ */
+#define CONCURRENT_ARRAY_WRITER_BYTES 4096
+
+typedef struct ConcurrentArrayWriter
+{
+    ConcurrentArray *array;
+    size_t n_elements;
+    size_t capacity;
+    max_align_t buffer[CONCURRENT_ARRAY_WRITER_BYTES / sizeof(max_align_t)];
+} ConcurrentArrayWriter;
+
+ConcurrentArrayWriter ConcurrentArray_writer(ConcurrentArray *self);
+void _ConcurrentArrayWriter_push(ConcurrentArrayWriter *writer, void *element);
+#define ConcurrentArrayWriter_push(writer, element)                            \
+    {                                                                          \
+        __auto_type ConcurrentArray_push_temp_var = element;                   \
+        _ConcurrentArrayWriter_push(writer, &ConcurrentArray_push_temp_var);   \
+    }
+void ConcurrentArrayWriter_flush(ConcurrentArrayWriter *writer);
+
+#endif // #ifndef CONCURRENT_ARRAY_H
+
+#if defined(CONCURRENT_ARRAY_INCLUDE_IMPLEMENTATION) &&                        \
+    !defined(CONCURRENT_ARRAY_IMPLEMENTATION_INCLUDED)
+#define CONCURRENT_ARRAY_IMPLEMENTATION_INCLUDED
+
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+#define CONCURRENT_ARRAY_INTERNAL static inline
+
+#define CONCURRENT_ARRAY_SEGMENT_LENGTH(self, k)                               \
+    ((size_t)1 << ((self)->first_shift + (k)))
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+ConcurrentArray *_ConcurrentArray_create(size_t element_size,
+                                         size_t first_capacity,
+                                         void *(*allocator)(size_t),
+                                         void (*liberator)(void *))
+{
+    ConcurrentArray *self = allocator(sizeof(ConcurrentArray));
+    atomic_init(&self->n_elements, 0);
+    for (size_t k = 0; k < CONCURRENT_ARRAY_MAX_SEGMENTS; k++)
+    {
+        atomic_init(&self->segments[k], NULL);
+    }
+    self->element_size = element_size;
+    self->first_shift = 0;
+    while (((size_t)1 << self->first_shift) < first_capacity)
+    {
+        self->first_shift += 1;
+    }
+    self->allocator = allocator;
+    self->liberator = liberator;
+    return self;
+}
+
+void ConcurrentArray_destroy(ConcurrentArray *self)
+{
+    for (size_t k = 0; k < CONCURRENT_ARRAY_MAX_SEGMENTS; k++)
+    {
+        void *segment = atomic_load(&self->segments[k]);
+        if (segment != NULL)
+        {
+            self->liberator(segment);
+        }
+    }
+    self->liberator(self);
+}
+
+/* * * *  SEGMENTS  * * * */
+/* * * * (Internal) * * * */
+
+// segment k and offset of an index, see SegmentedArray_at
+CONCURRENT_ARRAY_INTERNAL size_t ConcurrentArray_locate(ConcurrentArray *self,
+                                                        size_t index,
+                                                        size_t *offset)
+{
+    size_t biased = index + ((size_t)1 << self->first_shift);
+    size_t top = 63 - __builtin_clzll(biased);
+    *offset = biased - ((size_t)1 << top);
+    return top - self->first_shift;
+}
+
+// marks a segment that one thread is allocating, never a valid address
+#define CONCURRENT_ARRAY_PENDING ((void *)1)
+
+// returns segment k, the first thread to get there claims it and allocates,
+// the others wait for it instead of allocating a segment to throw away
+CONCURRENT_ARRAY_INTERNAL void *ConcurrentArray_segment(ConcurrentArray *self,
+                                                        size_t k)
+{
+    void *segment = atomic_load_explicit(&self->segments[k],
+                                         memory_order_acquire);
+    if (segment == NULL &&
+        atomic_compare_exchange_strong_explicit(
+            &self->segments[k], &segment, CONCURRENT_ARRAY_PENDING,
+            memory_order_acquire, memory_order_acquire))
+    {
+        segment = self->allocator(CONCURRENT_ARRAY_SEGMENT_LENGTH(self, k) *
+                                  self->element_size);
+        atomic_store_explicit(&self->segments[k], segment,
+                              memory_order_release);
+        return segment;
+    }
+    // the claiming thread only runs the allocator, give it the processor
+    while (segment == CONCURRENT_ARRAY_PENDING)
+    {
+        sched_yield();
+        segment = atomic_load_explicit(&self->segments[k],
+                                       memory_order_acquire);
+    }
+    return segment;
+}
+
+/* * * * GETTERS * * * */
+
+size_t ConcurrentArray_length(ConcurrentArray *self)
+{
+    return atomic_load_explicit(&self->n_elements, memory_order_acquire);
+}
+
+void *ConcurrentArray_get(ConcurrentArray *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index >= ConcurrentArray_length(self))
+    {
+        printf("ConcurrentArray: refused to carry on with call to "
+               "ConcurrentArray_get, index overflows array length\n");
+        return NULL;
+    }
+#endif
+    size_t offset;
+    size_t k = ConcurrentArray_locate(self, index, &offset);
+    return atomic_load_explicit(&self->segments[k], memory_order_acquire) +
+           offset * self->element_size;
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+size_t _ConcurrentArray_push(ConcurrentArray *self, void *element)
+{
+    size_t index =
+        atomic_fetch_add_explicit(&self->n_elements, 1, memory_order_relaxed);
+    size_t offset;
+    size_t k = ConcurrentArray_locate(self, index, &offset);
+    memcpy(ConcurrentArray_segment(self, k) + offset * self->element_size,
+           element, self->element_size);
+    return index;
+}
+
+// one reservation for all n elements, then one memcpy per touched segment
+size_t ConcurrentArray_push_multiple(ConcurrentArray *self, void *array,
+                                     size_t n)
+{
+    size_t start =
+        atomic_fetch_add_explicit(&self->n_elements, n, memory_order_relaxed);
+    size_t index = start;
+    while (n > 0)
+    {
+        size_t offset;
+        size_t k = ConcurrentArray_locate(self, index, &offset);
+        size_t room = CONCURRENT_ARRAY_SEGMENT_LENGTH(self, k) - offset;
+        size_t chunk = n < room ? n : room;
+        memcpy(ConcurrentArray_segment(self, k) + offset * self->element_size,
+               array, chunk * self->element_size);
+        array += chunk * self->element_size;
+        index += chunk;
+        n -= chunk;
+    }
+    return start;
+}
+
+/* * * * WRITERS * * * */
+
+ConcurrentArrayWriter ConcurrentArray_writer(ConcurrentArray *self)
+{
+    ConcurrentArrayWriter writer = {
+        .array = self,
+        .n_elements = 0,
+        .capacity = sizeof(writer.buffer) / self->element_size,
+    };
+    return writer;
+}
+
+void _ConcurrentArrayWriter_push(ConcurrentArrayWriter *writer, void *element)
+{
+    size_t element_size = writer->array->element_size;
+    if (writer->capacity == 0)
+    {
+        _ConcurrentArray_push(writer->array, element);
+        return;
+    }
+    if (writer->n_elements == writer->capacity)
+    {
+        ConcurrentArrayWriter_flush(writer);
+    }
+    memcpy((void *)writer->buffer + writer->n_elements * element_size, element,
+           element_size);
+    writer->n_elements += 1;
+}
+
+void ConcurrentArrayWriter_flush(ConcurrentArrayWriter *writer)
+{
+    if (writer->n_elements > 0)
+    {
+        ConcurrentArray_push_multiple(writer->array, writer->buffer,
+                                      writer->n_elements);
+        writer->n_elements = 0;
+    }
+}
+
+/* * * * CONVERSION * * * */
+
+void *ConcurrentArray_to_Darray(ConcurrentArray *self)
+{
+    size_t n = ConcurrentArray_length(self);
+    void *result = _Darray_create(self->element_size, n + 1, malloc, realloc,
+                                  free);
+    for (size_t k = 0, start = 0; start < n; k++)
+    {
+        size_t length = CONCURRENT_ARRAY_SEGMENT_LENGTH(self, k);
+        size_t chunk = n - start < length ? n - start : length;
+        _Darray_push_multiple(&result, atomic_load(&self->segments[k]), chunk);
+        start += chunk;
+    }
+    return result;
+}
+
+#endif // #if defined(CONCURRENT_ARRAY_INCLUDE_IMPLEMENTATION)
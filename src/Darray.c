@@ -1,17 +1,278 @@
 #ifndef DARRAY_H
 #define DARRAY_H
 
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
+
+typedef void *(*malloc_t)(size_t);
+typedef void *(*realloc_t)(void *, size_t);
+typedef void (*free_t)(void *);
+
+// how the capacity grows when an array is full, see Darray_set_growth
+typedef enum DarrayGrowth
+{
+    DARRAY_GROWTH_DOUBLE = 0,
+    DARRAY_GROWTH_ONE_AND_HALF,
+    DARRAY_GROWTH_PAGE,
+    DARRAY_GROWTH_FIXED,
+} DarrayGrowth;
+
+typedef struct Darray
+{
+    size_t n_elements;
+    size_t element_size;
+    size_t capacity;
+    size_t reserve_space;
+    // free element slots in front of the payload, see the front operations
+    size_t front_space;
+    size_t flags;
+    DarrayGrowth growth;
+    size_t growth_increment;
+
+    malloc_t allocator;
+    realloc_t reallocator;
+    free_t liberator;
+    union
+    {
+        // only set for arrays created with Darray_create_arena
+        struct DarrayArena *arena;
+        // only set for arrays created with Darray_create_file
+        int fd;
+        // only set with DARRAY_STATS, for arrays that are neither of the above
+        struct DarrayStats *stats;
+    };
+} Darray;
+
+// the header only moves in steps of its alignment, a front gap that is not
+// a multiple of it leaves up to DARRAY_HEADER_ALIGNMENT - 1 bytes between the
+// header and the payload
+#define DARRAY_HEADER_ALIGNMENT _Alignof(Darray)
+#define DARRAY_HEADER_OFFSET(front_bytes)                                      \
+    ((front_bytes) & ~(DARRAY_HEADER_ALIGNMENT - 1))
+#define DARRAY_HEADER_GAP(front_bytes)                                         \
+    ((front_bytes) & (DARRAY_HEADER_ALIGNMENT - 1))
+
+#define GET_SELF(data)                                                         \
+    ((Darray *)(((uintptr_t)(data) - sizeof(Darray)) &                         \
+                ~(uintptr_t)(DARRAY_HEADER_ALIGNMENT - 1)))
+#define GET_DATA(self)                                                         \
+    ((void *)(self) + sizeof(Darray) +                                         \
+     DARRAY_HEADER_GAP((self)->front_space * (self)->element_size))
+#define GET_BASE(self)                                                         \
+    ((void *)(self) -                                                          \
+     DARRAY_HEADER_OFFSET((self)->front_space * (self)->element_size))
+
+// the storage was provided by the caller and is not freed by the array
+#define DARRAY_FLAG_BORROWED ((size_t)1 << 0)
+// the storage lives in a DarrayArena and is released by DarrayArena_reset
+#define DARRAY_FLAG_ARENA ((size_t)1 << 1)
+// the storage was obtained with mmap, see DARRAY_MAP_THRESHOLD
+#define DARRAY_FLAG_MAPPED ((size_t)1 << 2)
+// options, see Darray_set_options
+#define DARRAY_OPTION_HUGE_PAGES ((size_t)1 << 3)
+#define DARRAY_OPTION_PREFAULT ((size_t)1 << 4)
+// the storage is a shared mapping of a file, see Darray_create_file
+#define DARRAY_FLAG_FILE ((size_t)1 << 5)
+// aligned arrays keep log2 of the alignment and the number of bytes skipped
+// at the start of the allocation to reach it in flags
+#define DARRAY_ALIGNMENT_SHIFT 8
+#define DARRAY_ALIGNMENT_MASK ((size_t)0xff << DARRAY_ALIGNMENT_SHIFT)
+#define DARRAY_PADDING_SHIFT 16
+#define DARRAY_PADDING_MASK ((size_t)0xffff << DARRAY_PADDING_SHIFT)
+// the block came from the buffer cache and is exactly 1 << class bytes, 0
+// for blocks of any other size
+#define DARRAY_CACHE_CLASS_SHIFT 32
+#define DARRAY_CACHE_CLASS_MASK ((size_t)0xff << DARRAY_CACHE_CLASS_SHIFT)
+
+/*
+ * Statistics, compiled in with -DDARRAY_STATS: every array created with
+ * Darray_create, Darray_create_allocator or Darray_create_aligned is tagged
+ * with the file and line of the call and counts its reallocations, the bytes
+ * moved by the middle, front and removal functions, and its peak capacity
+ * against its peak length. Arrays created by other functions of this library
+ * are counted under an "(untracked)" site, arrays in arenas, files and caller
+ * buffers are not counted. Darray_stats_dump prints one line per call site
+ * with destroyed and live arrays together.
+ */
+#ifdef DARRAY_STATS
+#include <stdio.h>
+
+typedef struct DarrayStats
+{
+    size_t element_size;
+    size_t n_reallocs;
+    size_t bytes_moved;
+    size_t peak_capacity;
+    size_t peak_length;
+
+    struct DarrayStatsSite *site;
+    // the live arrays of a site
+    struct DarrayStats *previous;
+    struct DarrayStats *next;
+} DarrayStats;
+
+typedef struct DarrayStatsSite
+{
+    const char *file;
+    int line;
+    bool registered;
+    size_t n_arrays;
+    DarrayStats *live;
+
+    // totals of the destroyed arrays, peaks are the largest of any array
+    size_t n_reallocs;
+    size_t bytes_moved;
+    size_t peak_capacity;
+    size_t peak_length;
+    size_t slack_bytes;
+
+    struct DarrayStatsSite *next;
+} DarrayStatsSite;
+
+void *Darray_stats_attach(void *data, DarrayStatsSite *site);
+// a copy of the counters of one array, zero for arrays that are not counted
+DarrayStats Darray_get_stats(void *data);
+void Darray_stats_dump(FILE *stream);
+
+#define DARRAY_STATS_SITE(data)                                                \
+    __extension__({                                                            \
+        static DarrayStatsSite Darray_stats_site = {.file = __FILE__,          \
+                                                    .line = __LINE__};         \
+        Darray_stats_attach(data, &Darray_stats_site);                         \
+    })
+
+static inline DarrayStats *Darray_stats_of(Darray *self)
+{
+    return self->flags & (DARRAY_FLAG_ARENA | DARRAY_FLAG_FILE) ? NULL
+                                                                : self->stats;
+}
+
+// the owner writes the counters, Darray_stats_dump may read them from any
+// thread
+static inline void Darray_stats_length(Darray *self, size_t n)
+{
+    DarrayStats *stats = Darray_stats_of(self);
+    if (stats != NULL && n > stats->peak_length)
+    {
+        __atomic_store_n(&stats->peak_length, n, __ATOMIC_RELAXED);
+    }
+}
+
+static inline void Darray_stats_moved(Darray *self, size_t bytes)
+{
+    DarrayStats *stats = Darray_stats_of(self);
+    if (stats != NULL)
+    {
+        __atomic_store_n(&stats->bytes_moved, stats->bytes_moved + bytes,
+                         __ATOMIC_RELAXED);
+    }
+}
+#define DARRAY_STATS_LENGTH(self, n) Darray_stats_length(self, n)
+#define DARRAY_STATS_MOVED(self, bytes) Darray_stats_moved(self, bytes)
+#else
+#define DARRAY_STATS_SITE(data) (data)
+#define DARRAY_STATS_LENGTH(self, n)
+#define DARRAY_STATS_MOVED(self, bytes)
+#endif
+
+/*
+ * Bump arena for scratch arrays. Growing the array that was allocated last
+ * extends it in place, destroying it gives the space back, everything else is
+ * only released in bulk by DarrayArena_reset or DarrayArena_destroy. The arena
+ * must not move while arrays created from it are alive.
+ */
+typedef struct DarrayArenaBlock
+{
+    struct DarrayArenaBlock *previous;
+    size_t size;
+    size_t used;
+} DarrayArenaBlock;
+
+typedef struct DarrayArena
+{
+    DarrayArenaBlock *block;
+    void *last;
+    size_t block_size;
+
+    malloc_t allocator;
+    free_t liberator;
+} DarrayArena;
 
 // getters
 
 void *_Darray_create(size_t, size_t, void *(*)(size_t),
                      void *(*)(void *, size_t), void (*)(void *));
 #define Darray_create(type, capacity)                                          \
-    _Darray_create(sizeof(type), capacity, malloc, realloc, free)
+    DARRAY_STATS_SITE(                                                         \
+        _Darray_create(sizeof(type), capacity, malloc, realloc, free))
 #define Darray_create_allocator(type, capacity, malloc, realloc, free)         \
-    _Darray_create(sizeof(type), capacity, malloc, realloc, free)
+    DARRAY_STATS_SITE(                                                         \
+        _Darray_create(sizeof(type), capacity, malloc, realloc, free))
+
+/*
+ * Aligned arrays: the payload starts at a multiple of alignment, a power of
+ * two up to DARRAY_PAGE_SIZE, typically 32 or 64 for SIMD loads. Up to
+ * alignment - 1 bytes are allocated on top and the block is shifted into
+ * place after every reallocation. The *_beg functions move the payload by
+ * whole elements and so lose the alignment until the next reallocation.
+ */
+void *_Darray_create_aligned(size_t, size_t, size_t, void *(*)(size_t),
+                             void *(*)(void *, size_t), void (*)(void *));
+#define Darray_create_aligned(type, capacity, alignment)                       \
+    DARRAY_STATS_SITE(_Darray_create_aligned(sizeof(type), capacity,           \
+                                             alignment, malloc, realloc, free))
+
+/*
+ * Small buffer arrays: the first elements live in storage provided by the
+ * caller, the array moves to memory obtained from the allocator on the first
+ * growth that does not fit. Darray_create_stack uses a compound literal, the
+ * array must not outlive the enclosing block and n must be a constant.
+ */
+void *_Darray_create_buffer(size_t, void *, size_t, void *(*)(size_t),
+                            void *(*)(void *, size_t), void (*)(void *));
+#define Darray_create_buffer(type, buffer, buffer_size)                        \
+    _Darray_create_buffer(sizeof(type), buffer, buffer_size, malloc, realloc,  \
+                          free)
+#define DARRAY_BUFFER_SIZE(type, n) (sizeof(Darray) + (n) * sizeof(type))
+#define Darray_create_stack(type, n)                                           \
+    Darray_create_buffer(                                                      \
+        type,                                                                  \
+        (max_align_t[(DARRAY_BUFFER_SIZE(type, n) + sizeof(max_align_t) - 1) / \
+                     sizeof(max_align_t)]){0},                                 \
+        DARRAY_BUFFER_SIZE(type, n))
+
+DarrayArena _DarrayArena_create(size_t, void *(*)(size_t), void (*)(void *));
+#define DarrayArena_create(block_size)                                         \
+    _DarrayArena_create(block_size, malloc, free)
+#define DarrayArena_create_allocator(block_size, malloc, free)                 \
+    _DarrayArena_create(block_size, malloc, free)
+void DarrayArena_reset(DarrayArena *arena);
+void DarrayArena_destroy(DarrayArena *arena);
+
+void *_Darray_create_arena(size_t, size_t, DarrayArena *);
+#define Darray_create_arena(type, capacity, arena)                             \
+    _Darray_create_arena(sizeof(type), capacity, arena)
+
+/*
+ * Persistent arrays (Linux only): the file holds the header followed by the
+ * elements and is mapped shared, so the array is the file. Growing extends
+ * the file with ftruncate and remaps it. Darray_open_file maps an existing
+ * file without reading it and returns NULL if the file is missing or does not
+ * hold an array of that element type. Darray_destroy unmaps and closes the
+ * file, Darray_sync flushes it to disk. The *_beg functions can leave a gap
+ * in front of the header, both move the header back to the start of the file.
+ * Elements must not hold pointers.
+ */
+void *_Darray_create_file(size_t, size_t, const char *);
+#define Darray_create_file(type, capacity, path)                               \
+    _Darray_create_file(sizeof(type), capacity, path)
+void *_Darray_open_file(size_t, const char *);
+#define Darray_open_file(type, path) _Darray_open_file(sizeof(type), path)
+bool _Darray_sync(void **);
+#define Darray_sync(data_p) _Darray_sync((void **)data_p)
 
 void Darray_destroy(void *data);
 
@@ -22,6 +283,43 @@ size_t Darray_get_reserve(void *data);
 void _Darray_reserve(void **, size_t);
 #define Darray_reserve(data_p, nrs) _Darray_reserve((void **)data_p, nrs)
 
+/*
+ * Growth and shrinking: full arrays grow according to their DarrayGrowth,
+ * increment is the number of elements added by DARRAY_GROWTH_FIXED and is
+ * ignored otherwise. Popping shrinks the array to twice its length once it is
+ * down to a quarter of its capacity, but never below the reserve, so
+ * oscillating around a size boundary does not reallocate on every call.
+ */
+void Darray_set_growth(void *data, DarrayGrowth growth, size_t increment);
+
+void _Darray_shrink_to_fit(void **);
+#define Darray_shrink_to_fit(data_p) _Darray_shrink_to_fit((void **)data_p)
+
+/*
+ * Large arrays: on Linux (built with _GNU_SOURCE) an array using the C library
+ * allocator moves to its own mapping once it needs DARRAY_MAP_THRESHOLD bytes,
+ * after that it grows and shrinks with mremap, which never copies the payload.
+ * DARRAY_OPTION_HUGE_PAGES asks for transparent huge pages on the mapping,
+ * DARRAY_OPTION_PREFAULT makes every Darray_reserve fault in the reserved
+ * space up front, whether it grows the array or not, for any kind of storage.
+ */
+void Darray_set_options(void *data, size_t options);
+
+/*
+ * Buffer cache: a thread can keep the blocks of the arrays it destroys in
+ * power of two size classes, header included, and hand them to the next
+ * array it creates or grows instead of going through malloc, realloc and
+ * free. Only arrays on the C library allocator that are not aligned take
+ * part, and while the cache is on their blocks are rounded up to a whole
+ * class, the extra room becomes capacity. The cache of a thread is off until
+ * it gets a byte budget, Darray_cache_trim frees cached blocks until at most
+ * bytes are left. Blocks are not freed when a thread exits, call
+ * Darray_cache_trim(0) first.
+ */
+void Darray_cache_set_budget(size_t bytes);
+void Darray_cache_trim(size_t bytes);
+size_t Darray_cache_get_size(void);
+
 void _Darray_push(void **, void *);
 #define Darray_push(data_p, element)                                           \
     {                                                                          \
@@ -57,7 +355,17 @@ void _Darray_push_middle_multiple(void **, size_t, void *, size_t);
 
 void _Darray_pop_middle_multiple(void **, size_t, void *, size_t);
 #define Darray_pop_middle_multiple(data_p, index, out, n)                      \
-    _Darray_push_middle_multiple((void **)data_p, index, arr, n)
+    _Darray_pop_middle_multiple((void **)data_p, index, out, n)
+
+/*
+ * Inserts values[j] before the element at indices[j] of the array as it was
+ * before the call, an index equal to the length appends. indices must be
+ * sorted in ascending order, values sharing an index keep their order. The
+ * array grows at most once and every element is moved at most once.
+ */
+void _Darray_insert_batch(void **, const size_t *, const void *, size_t);
+#define Darray_insert_batch(data_p, indices, values, k)                        \
+    _Darray_insert_batch((void **)data_p, indices, values, k)
 
 void _Darray_push_beg(void **, void *);
 #define Darray_push_beg(data_p, element)                                       \
@@ -85,351 +393,2578 @@ void _Darray_merge_beg(void **, void *, size_t);
 #define Darray_merge_beg(data_p1, data2, index)                                \
     _Darray_merge_beg((void **)data_p1, data2, index)
 
+/*
+ * Bulk removal: these compact the array in a single pass and resize it at
+ * most once, the remaining elements keep their order. predicate is called
+ * with a pointer to each element and context, indices must be sorted in
+ * ascending order without duplicates. All of them return the number of
+ * removed elements.
+ */
+size_t _Darray_remove_if(void **, bool (*)(const void *, void *), void *);
+#define Darray_remove_if(data_p, predicate, context)                           \
+    _Darray_remove_if((void **)data_p, predicate, context)
+
+size_t _Darray_retain(void **, bool (*)(const void *, void *), void *);
+#define Darray_retain(data_p, predicate, context)                              \
+    _Darray_retain((void **)data_p, predicate, context)
+
+size_t _Darray_remove_indices(void **, const size_t *, size_t);
+#define Darray_remove_indices(data_p, indices, n)                              \
+    _Darray_remove_indices((void **)data_p, indices, n)
+
+// O(1) removal that fills the hole with the last element, order is not kept
+void _Darray_swap_remove(void **, size_t, void *);
+#define Darray_swap_remove(data_p, index, out)                                 \
+    _Darray_swap_remove((void **)data_p, index, out)
+
+// copies the elements in [start_index, end_index) into a new array that uses
+// the same storage as data, Darray_split is the old name of Darray_split_copy
+void *Darray_split_copy(void *data, size_t start_index, size_t end_index);
 void *Darray_split(void *data, size_t start_index, size_t end_index);
 
+/*
+ * Slices: a non owning view of a contiguous run of elements, taken from an
+ * array or from another slice without allocating or copying. A slice is only
+ * valid until the array it points into is resized or destroyed.
+ * DarraySlice_to_Darray copies the viewed elements into a new array.
+ */
+typedef struct DarraySlice
+{
+    void *data;
+    size_t length;
+    size_t element_size;
+} DarraySlice;
+
+DarraySlice Darray_slice(void *data, size_t start_index, size_t end_index);
+DarraySlice DarraySlice_slice(DarraySlice slice, size_t start_index,
+                              size_t end_index);
+void *DarraySlice_to_Darray(DarraySlice slice);
+#define DarraySlice_get(slice, index)                                          \
+    ((slice).data + (index) * (slice).element_size)
+// iterates name, a pointer to type, over every element of the slice
+#define DarraySlice_for_each(slice, type, name)                                \
+    for (type *name = (slice).data;                                            \
+         name < (type *)(slice).data + (slice).length; name++)
+
 void Darray_print(void *data, const char *const format,
                   void (*print_func)(void *));
 
+/*
+ * Search and reduction over arrays of primitive types, type must match the
+ * element type of the array. value and out point to a variable of that type,
+ * except for Darray_sum which writes an int64_t for signed, a uint64_t for
+ * unsigned and a double for floating point arrays. Darray_find returns -1 if
+ * the value is not present, Darray_min and Darray_max return false and leave
+ * out untouched on an empty array. On x86-64 Linux the kernels are compiled
+ * for AVX-512, AVX2 and SSE2 and picked at load time, DARRAY_NO_SIMD compiles
+ * plain scalar loops instead.
+ */
+typedef enum DarrayType
+{
+    DARRAY_I8,
+    DARRAY_U8,
+    DARRAY_I16,
+    DARRAY_U16,
+    DARRAY_I32,
+    DARRAY_U32,
+    DARRAY_I64,
+    DARRAY_U64,
+    DARRAY_F32,
+    DARRAY_F64,
+} DarrayType;
+
+size_t Darray_find(void *data, DarrayType type, const void *value);
+size_t Darray_count(void *data, DarrayType type, const void *value);
+bool Darray_contains(void *data, DarrayType type, const void *value);
+bool Darray_min(void *data, DarrayType type, void *out);
+bool Darray_max(void *data, DarrayType type, void *out);
+void Darray_sum(void *data, DarrayType type, void *out);
+
+// the same over a slice
+size_t DarraySlice_find(DarraySlice slice, DarrayType type, const void *value);
+size_t DarraySlice_count(DarraySlice slice, DarrayType type, const void *value);
+bool DarraySlice_contains(DarraySlice slice, DarrayType type,
+                          const void *value);
+bool DarraySlice_min(DarraySlice slice, DarrayType type, void *out);
+bool DarraySlice_max(DarraySlice slice, DarrayType type, void *out);
+void DarraySlice_sum(DarraySlice slice, DarrayType type, void *out);
+
+/*
+ * Sorting: Darray_sort sorts arrays of primitive types in ascending order with
+ * an LSD radix sort. Darray_sort_compare takes a qsort style comparator and
+ * uses a pattern defeating introsort, moving elements with swaps specialized
+ * for 1, 2, 4, 8 and 16 byte elements. Neither sort is stable.
+ */
+void Darray_sort(void *data, DarrayType type);
+void Darray_sort_compare(void *data,
+                         int (*compare)(const void *, const void *));
+// sorts the elements in [start_index, end_index) only
+void Darray_sort_range(void *data, size_t start_index, size_t end_index,
+                       int (*compare)(const void *, const void *));
+
+void _Darray_make_room(void **, size_t);
+
+/*
+ * Typed Darray functions: DARRAY_DEFINE(Floats, float) emits Floats_create,
+ * Floats_push, Floats_pop, Floats_insert, Floats_remove, Floats_get and
+ * Floats_set. The element size is a compile time constant so the fast paths
+ * inline into a capacity check plus a plain store, growth goes through the
+ * same code as the generic functions. The arrays are ordinary Darrays, the
+ * generic functions work on them too. Popping never releases memory.
+ */
+#define DARRAY_DEFINE(name, type)                                              \
+    static inline type *name##_create(size_t capacity)                         \
+    {                                                                          \
+        return _Darray_create(sizeof(type), capacity, malloc, realloc, free);  \
+    }                                                                          \
+                                                                               \
+    static inline void name##_push(type **data_p, type element)                \
+    {                                                                          \
+        Darray *self = GET_SELF((void *)*data_p);                              \
+        if (__builtin_expect(self->n_elements + 1 >= self->capacity, 0))       \
+        {                                                                      \
+            _Darray_make_room((void **)data_p, 1);                             \
+            self = GET_SELF((void *)*data_p);                                  \
+        }                                                                      \
+        (*data_p)[self->n_elements] = element;                                 \
+        self->n_elements += 1;                                                 \
+        DARRAY_STATS_LENGTH(self, self->n_elements);                           \
+    }                                                                          \
+                                                                               \
+    static inline type name##_pop(type **data_p)                               \
+    {                                                                          \
+        Darray *self = GET_SELF((void *)*data_p);                              \
+        self->n_elements -= 1;                                                 \
+        return (*data_p)[self->n_elements];                                    \
+    }                                                                          \
+                                                                               \
+    static inline void name##_insert(type **data_p, size_t index,              \
+                                     type element)                             \
+    {                                                                          \
+        Darray *self = GET_SELF((void *)*data_p);                              \
+        if (__builtin_expect(self->n_elements + 1 >= self->capacity, 0))       \
+        {                                                                      \
+            _Darray_make_room((void **)data_p, 1);                             \
+            self = GET_SELF((void *)*data_p);                                  \
+        }                                                                      \
+        type *data = *data_p;                                                  \
+        memmove(&data[index + 1], &data[index],                                \
+                (self->n_elements - index) * sizeof(type));                    \
+        DARRAY_STATS_MOVED(self, (self->n_elements - index) * sizeof(type));   \
+        data[index] = element;                                                 \
+        self->n_elements += 1;                                                 \
+        DARRAY_STATS_LENGTH(self, self->n_elements);                           \
+    }                                                                          \
+                                                                               \
+    static inline type name##_remove(type **data_p, size_t index)              \
+    {                                                                          \
+        Darray *self = GET_SELF((void *)*data_p);                              \
+        type *data = *data_p;                                                  \
+        type result = data[index];                                             \
+        self->n_elements -= 1;                                                 \
+        memmove(&data[index], &data[index + 1],                                \
+                (self->n_elements - index) * sizeof(type));                    \
+        DARRAY_STATS_MOVED(self, (self->n_elements - index) * sizeof(type));   \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    static inline type name##_get(type *data, size_t index)                    \
+    {                                                                          \
+        return data[index];                                                    \
+    }                                                                          \
+                                                                               \
+    static inline void name##_set(type *data, size_t index, type element)      \
+    {                                                                          \
+        data[index] = element;                                                 \
+    }
+
 #endif
 
-#ifdef DARRAY_INCLUDE_IMPLEMENTATION
+#if defined(DARRAY_INCLUDE_IMPLEMENTATION) &&                                  \
+    !defined(DARRAY_IMPLEMENTATION_INCLUDED)
+#define DARRAY_IMPLEMENTATION_INCLUDED
 
 #include <stddef.h>
 #include <stdio.h>
 #include <string.h>
 
-typedef void *(*malloc_t)(size_t);
-typedef void *(*realloc_t)(void *, size_t);
-typedef void (*free_t)(void *);
+#define DARRAY_INTERNAL static inline
 
-typedef struct Darray
-{
-    size_t n_elements;
-    size_t element_size;
-    size_t capacity;
-    size_t reserve_space;
+#ifndef DARRAY_PAGE_SIZE
+#define DARRAY_PAGE_SIZE 4096
+#endif
 
-    malloc_t allocator;
-    realloc_t reallocator;
-    free_t liberator;
-} Darray;
+#if defined(__linux__) && !defined(DARRAY_NO_MAP)
+#include <sys/mman.h>
+#if defined(MREMAP_MAYMOVE)
+#define DARRAY_MAP
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#endif
 
-#define GET_SELF(data) (Darray *)(data - sizeof(Darray))
-#define GET_DATA(self) (void *)(self) + sizeof(Darray)
+#ifndef DARRAY_MAP_THRESHOLD
+#define DARRAY_MAP_THRESHOLD ((size_t)64 << 20)
+#endif
 
-#define DARRAY_INTERNAL static inline
+#define DARRAY_OPTIONS (DARRAY_OPTION_HUGE_PAGES | DARRAY_OPTION_PREFAULT)
 
-void *_Darray_create(size_t element_size, size_t initial_capacity,
-                     malloc_t allocator, realloc_t reallocator,
-                     free_t liberator)
+#ifdef DARRAY_STATS
+#include <pthread.h>
+#define DARRAY_STATS_CREATE(self) Darray_stats_create(self)
+#define DARRAY_STATS_REALLOC(self) Darray_stats_realloc(self)
+#define DARRAY_STATS_RELEASE(self) Darray_stats_release(self)
+#else
+#define DARRAY_STATS_CREATE(self)
+#define DARRAY_STATS_REALLOC(self)
+#define DARRAY_STATS_RELEASE(self)
+#endif
+
+// bytes of the whole block: front gap, header and capacity
+#define DARRAY_BLOCK_SIZE(self)                                                \
+    (((self)->front_space + (self)->capacity) * (self)->element_size +         \
+     sizeof(Darray))
+
+// 1 and 0 for arrays that were not created aligned
+#define DARRAY_ALIGNMENT(self)                                                 \
+    ((size_t)1 << (((self)->flags & DARRAY_ALIGNMENT_MASK) >>                  \
+                   DARRAY_ALIGNMENT_SHIFT))
+#define DARRAY_PADDING(self)                                                   \
+    (((self)->flags & DARRAY_PADDING_MASK) >> DARRAY_PADDING_SHIFT)
+// what the allocator returned and how much was asked for, the block plus
+// room to align it
+#define DARRAY_ALLOCATION(self) (GET_BASE(self) - DARRAY_PADDING(self))
+#define DARRAY_ALLOCATION_SIZE(self)                                           \
+    (DARRAY_BLOCK_SIZE(self) + DARRAY_ALIGNMENT(self) - 1)
+
+#define DARRAY_ARENA_ALIGNMENT sizeof(max_align_t)
+#define DARRAY_ARENA_ALIGN(size)                                               \
+    (((size) + DARRAY_ARENA_ALIGNMENT - 1) & ~(DARRAY_ARENA_ALIGNMENT - 1))
+#define DARRAY_ARENA_BLOCK_DATA(block)                                         \
+    ((void *)(block) + DARRAY_ARENA_ALIGN(sizeof(DarrayArenaBlock)))
+
+/* * * * ARENA * * * */
+
+DarrayArena _DarrayArena_create(size_t block_size, malloc_t allocator,
+                                free_t liberator)
 {
-    Darray *self = malloc(element_size * initial_capacity + sizeof(Darray));
-    self->n_elements = 0;
-    self->element_size = element_size;
-    self->capacity = initial_capacity;
-    self->reserve_space = initial_capacity;
-    self->allocator = allocator;
-    self->reallocator = reallocator;
-    self->liberator = liberator;
+    DarrayArena result = {
+        .block = NULL,
+        .last = NULL,
+        .block_size = block_size,
+        .allocator = allocator,
+        .liberator = liberator,
+    };
+    return result;
+}
 
-    return GET_DATA(self);
+// frees every block but the newest one, which is kept for reuse
+void DarrayArena_reset(DarrayArena *arena)
+{
+    if (arena->block == NULL)
+    {
+        return;
+    }
+    DarrayArenaBlock *block = arena->block->previous;
+    while (block != NULL)
+    {
+        DarrayArenaBlock *previous = block->previous;
+        arena->liberator(block);
+        block = previous;
+    }
+    arena->block->previous = NULL;
+    arena->block->used = 0;
+    arena->last = NULL;
 }
 
-void Darray_destroy(void *data)
+void DarrayArena_destroy(DarrayArena *arena)
 {
-    Darray *self = GET_SELF(data);
-    self->liberator(self);
+    DarrayArena_reset(arena);
+    if (arena->block != NULL)
+    {
+        arena->liberator(arena->block);
+    }
+    memset(arena, 0, sizeof(DarrayArena));
 }
 
-/* * * *  RESIZING  * * * */
-/* * * * (Internal) * * * */
+DARRAY_INTERNAL void *DarrayArena_alloc(DarrayArena *arena, size_t size)
+{
+    size = DARRAY_ARENA_ALIGN(size);
+    DarrayArenaBlock *block = arena->block;
+    if (block == NULL || block->size - block->used < size)
+    {
+        size_t block_size =
+            arena->block_size < size ? size : arena->block_size;
+        block = arena->allocator(DARRAY_ARENA_ALIGN(sizeof(DarrayArenaBlock)) +
+                                 block_size);
+        block->previous = arena->block;
+        block->size = block_size;
+        block->used = 0;
+        arena->block = block;
+    }
+    arena->last = DARRAY_ARENA_BLOCK_DATA(block) + block->used;
+    block->used += size;
+    return arena->last;
+}
 
-DARRAY_INTERNAL void Darray_check_full_and_resize(Darray **self_p,
-                                                  void **data_p, size_t offset)
+DARRAY_INTERNAL void *DarrayArena_realloc(DarrayArena *arena, void *ptr,
+                                          size_t old_size, size_t new_size)
 {
-    Darray *const self = *self_p;
-    if (self->n_elements + offset >= self->capacity)
+    DarrayArenaBlock *block = arena->block;
+    if (ptr == arena->last)
     {
-        for (size_t i = 0; self->n_elements + offset >= self->capacity; i++)
+        size_t offset = ptr - DARRAY_ARENA_BLOCK_DATA(block);
+        if (offset + new_size <= block->size)
         {
-            self->capacity *= 2;
+            block->used = offset + DARRAY_ARENA_ALIGN(new_size);
+            return ptr;
         }
-        (*self_p) = self->reallocator(
-            self, self->capacity * self->element_size + sizeof(Darray));
-        (*data_p) = GET_DATA(self);
     }
+    void *result = DarrayArena_alloc(arena, new_size);
+    memcpy(result, ptr, old_size < new_size ? old_size : new_size);
+    return result;
 }
 
-DARRAY_INTERNAL void
-Darray_check_underused_and_resize(Darray **self_p, void **data_p, size_t offset)
+DARRAY_INTERNAL void DarrayArena_free(DarrayArena *arena, void *ptr)
 {
-    Darray *const self = *self_p;
-    if (self->n_elements - offset >= self->capacity / 4 &&
-        self->reserve_space >= self->capacity / 2)
+    if (ptr == arena->last)
     {
-        (*self_p) = self->reallocator(
-            self, self->capacity * self->element_size + sizeof(Darray));
-        (*data_p) = GET_DATA(self);
+        arena->block->used = ptr - DARRAY_ARENA_BLOCK_DATA(arena->block);
+        arena->last = NULL;
     }
 }
 
-/* * * * GETTERS * * * */
+/* * * * MAPPED STORAGE * * * */
 
-size_t Darray_length(void *data)
+#ifdef DARRAY_MAP
+
+#define DARRAY_MAP_SIZE(size)                                                  \
+    (((size) + DARRAY_PAGE_SIZE - 1) / DARRAY_PAGE_SIZE * DARRAY_PAGE_SIZE)
+
+DARRAY_INTERNAL void Darray_map_advise(void *base, size_t size, size_t flags)
 {
-    Darray *self = GET_SELF(data);
-    return self->n_elements;
+#ifdef MADV_HUGEPAGE
+    if (flags & DARRAY_OPTION_HUGE_PAGES)
+    {
+        madvise(base, DARRAY_MAP_SIZE(size), MADV_HUGEPAGE);
+    }
+#endif
 }
 
-size_t Darray_get_capacity(void *data)
+// returns NULL if the mapping could not be created
+DARRAY_INTERNAL void *Darray_map(size_t size, size_t flags)
 {
-    Darray *self = GET_SELF(data);
-    return self->capacity;
+    void *base = mmap(NULL, DARRAY_MAP_SIZE(size), PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    Darray_map_advise(base, size, flags);
+    return base;
 }
 
-size_t Darray_get_reserve(void *data)
+// returns NULL if the mapping could not be resized, the old one stays valid
+DARRAY_INTERNAL void *Darray_map_resize(void *base, size_t old_size,
+                                        size_t new_size, size_t flags)
 {
-    Darray *self = GET_SELF(data);
-    return self->reserve_space;
+    if (DARRAY_MAP_SIZE(old_size) == DARRAY_MAP_SIZE(new_size))
+    {
+        return base;
+    }
+    base = mremap(base, DARRAY_MAP_SIZE(old_size), DARRAY_MAP_SIZE(new_size),
+                  MREMAP_MAYMOVE);
+    if (base == MAP_FAILED)
+    {
+        return NULL;
+    }
+    Darray_map_advise(base, new_size, flags);
+    return base;
 }
 
-void _Darray_reserve(void **data_p, size_t new_reserve_space)
+// the file grows before and shrinks after the mapping, so the mapping never
+// extends past the end of the file by more than a page
+DARRAY_INTERNAL void *Darray_file_resize(Darray *self, size_t old_size,
+                                         size_t new_size)
 {
-    Darray *self = GET_SELF(*data_p);
-    if (new_reserve_space > self->capacity)
+    void *base = GET_BASE(self);
+    int fd = self->fd;
+    if (new_size > old_size && ftruncate(fd, new_size) != 0)
     {
-        self->capacity = new_reserve_space;
-        self = self->reallocator(self, self->capacity * self->element_size +
-                                           sizeof(Darray));
-        (*data_p) = GET_DATA(self);
+        perror("Darray: could not grow the file of a persistent array");
+        abort();
     }
-    self->reserve_space = new_reserve_space;
+    base = Darray_map_resize(base, old_size, new_size, 0);
+    if (base == NULL)
+    {
+        perror("Darray: could not remap the file of a persistent array");
+        abort();
+    }
+    if (new_size < old_size)
+    {
+        ftruncate(fd, new_size);
+    }
+    return base;
 }
 
-/* * * * ELEMENT MANIPULATION * * * */
+#endif // #ifdef DARRAY_MAP
 
-void _Darray_push(void **data_p, void *element)
+/* * * * BUFFER CACHE * * * */
+
+#define DARRAY_CACHE_CLASSES 64
+
+// written over the start of a cached block
+typedef struct DarrayCacheEntry
 {
-    Darray *self = GET_SELF(*data_p);
-    Darray_check_full_and_resize(&self, data_p, 1);
-    memcpy((*data_p) + (self->n_elements * self->element_size), element,
-           self->element_size);
-    self->n_elements += 1;
+    struct DarrayCacheEntry *next;
+    size_t size;
+} DarrayCacheEntry;
+
+typedef struct DarrayCache
+{
+    DarrayCacheEntry *classes[DARRAY_CACHE_CLASSES];
+    size_t size;
+    size_t budget;
+} DarrayCache;
+
+static _Thread_local DarrayCache Darray_cache;
+
+// smallest class whose blocks hold size bytes
+DARRAY_INTERNAL size_t Darray_cache_class(size_t size)
+{
+    return size <= 1 ? 0 : 64 - __builtin_clzll(size - 1);
 }
 
-void _Darray_pop(void **data_p, void *out)
+DARRAY_INTERNAL bool Darray_cache_eligible(Darray *self)
 {
-    Darray *self = GET_SELF(*data_p);
-#ifdef DARRAY_DEBUG
-    if (self->n_elements == 0)
-    {
-        printf("Darray: pop function called upon empty array.\n");
-        return;
-    }
-#endif
-    if (out != NULL)
+    return Darray_cache.budget > 0 && self->allocator == malloc &&
+           self->reallocator == realloc && self->liberator == free &&
+           !(self->flags & (DARRAY_FLAG_BORROWED | DARRAY_FLAG_ARENA |
+                            DARRAY_FLAG_MAPPED | DARRAY_FLAG_FILE)) &&
+           DARRAY_ALIGNMENT(self) == 1;
+}
+
+DARRAY_INTERNAL void *Darray_cache_take(size_t class)
+{
+    DarrayCacheEntry *entry = Darray_cache.classes[class];
+    if (entry != NULL)
     {
-        memcpy(out, (*data_p) + (self->n_elements - 1) * self->element_size,
-               self->element_size);
+        Darray_cache.classes[class] = entry->next;
+        Darray_cache.size -= entry->size;
     }
-    Darray_check_underused_and_resize(&self, data_p, 1);
-    self->n_elements -= 1;
+    return entry;
 }
 
-void _Darray_push_multiple(void **data_p, void *array, size_t n)
+// keeps the block of the array, false when it does not fit in the budget. A
+// block of any other size goes into the largest class it can serve.
+DARRAY_INTERNAL bool Darray_cache_put(Darray *self)
 {
-    Darray *self = GET_SELF(*data_p);
-    Darray_check_full_and_resize(&self, data_p, n);
-    memcpy((*data_p) + (self->n_elements * self->element_size), array,
-           n * self->element_size);
-    self->n_elements += n;
+    size_t class =
+        (self->flags & DARRAY_CACHE_CLASS_MASK) >> DARRAY_CACHE_CLASS_SHIFT;
+    size_t size = class ? (size_t)1 << class : DARRAY_BLOCK_SIZE(self);
+    if (Darray_cache.size + size > Darray_cache.budget)
+    {
+        return false;
+    }
+    class = 63 - __builtin_clzll(size);
+    DarrayCacheEntry *entry = GET_BASE(self);
+    entry->size = size;
+    entry->next = Darray_cache.classes[class];
+    Darray_cache.classes[class] = entry;
+    Darray_cache.size += size;
+    return true;
 }
 
-void _Darray_pop_multiple(void **data_p, void *out, size_t n)
+// resizes the block to the class that holds new_capacity elements, taking a
+// cached block when there is one. Returns the new block and its class,
+// new_capacity is raised to fill the class.
+DARRAY_INTERNAL void *Darray_cache_resize(Darray *self, size_t *new_capacity,
+                                          size_t *new_class)
 {
-    Darray *self = GET_SELF(*data_p);
-#ifdef DARRAY_DEBUG
-    if (self->n_elements < n)
+    size_t front_bytes = self->front_space * self->element_size;
+    size_t overhead = front_bytes + sizeof(Darray);
+    size_t class =
+        Darray_cache_class(overhead + *new_capacity * self->element_size);
+    *new_capacity = (((size_t)1 << class) - overhead) / self->element_size;
+    *new_class = class;
+    if (((self->flags & DARRAY_CACHE_CLASS_MASK) >>
+         DARRAY_CACHE_CLASS_SHIFT) == class)
     {
-        printf("Darray: refused to carry on with call to Darray_pop_multiple, "
-               "number "
-               "of elements to pop is greater than number of elements in the "
-               "array\n");
-        return;
+        return GET_BASE(self);
     }
-#endif
-    if (out != NULL)
+    void *block = Darray_cache_take(class);
+    if (block == NULL)
     {
-        memcpy(out, (*data_p) + (self->n_elements - n) * self->element_size,
-               n * self->element_size);
+        return realloc(GET_BASE(self), (size_t)1 << class);
     }
-    Darray_check_underused_and_resize(&self, data_p, n);
-    self->n_elements -= n;
+    // never more elements than the new block holds
+    size_t kept =
+        self->n_elements < *new_capacity ? self->n_elements : *new_capacity;
+    memcpy(block, GET_BASE(self), overhead + kept * self->element_size);
+    if (!Darray_cache_put(self))
+    {
+        free(GET_BASE(self));
+    }
+    return block;
 }
 
-void _Darray_push_middle(void **data_p, size_t index, void *element)
+void Darray_cache_set_budget(size_t bytes)
 {
-    Darray *self = GET_SELF(*data_p);
-#ifdef DARRAY_DEBUG
-    if (index > self->n_elements - 1)
+    Darray_cache.budget = bytes;
+    Darray_cache_trim(bytes);
+}
+
+// the largest blocks go first
+void Darray_cache_trim(size_t bytes)
+{
+    for (size_t class = DARRAY_CACHE_CLASSES;
+         class-- > 0 && Darray_cache.size > bytes;)
     {
-        printf("Darray: refused to carry on with call to _Darray_push_middle, "
-               "index overflows array length\n");
-        return;
+        while (Darray_cache.classes[class] != NULL &&
+               Darray_cache.size > bytes)
+        {
+            free(Darray_cache_take(class));
+        }
     }
-#endif
-    Darray_check_full_and_resize(&self, data_p, 1);
-    void *middle_p = (*data_p) + index * self->element_size;
-    memmove(middle_p + self->element_size, middle_p,
-            (self->n_elements - index) * self->element_size);
-    memcpy(middle_p, element, self->element_size);
-    self->n_elements += 1;
 }
 
-void _Darray_pop_middle(void **data_p, size_t index, void *out)
+size_t Darray_cache_get_size(void)
 {
-    Darray *self = GET_SELF(*data_p);
-#ifdef DARRAY_DEBUG
-    if (index > self->n_elements - 1)
-    {
-        printf("Darray: refused to carry on with call to _Darray_pop_middle, "
+    return Darray_cache.size;
+}
+
+/* * * * STATISTICS * * * */
+
+#ifdef DARRAY_STATS
+
+// guards the site list and the live lists, the counters of an array are only
+// written by the thread that owns the array
+static pthread_mutex_t Darray_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static DarrayStatsSite *Darray_stats_sites = NULL;
+static DarrayStatsSite Darray_stats_untracked = {.file = "(untracked)"};
+
+#define DARRAY_STATS_LOAD(field) __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+// called with the lock held
+DARRAY_INTERNAL void Darray_stats_link(DarrayStats *stats,
+                                       DarrayStatsSite *site)
+{
+    if (!site->registered)
+    {
+        site->registered = true;
+        site->next = Darray_stats_sites;
+        Darray_stats_sites = site;
+    }
+    site->n_arrays += 1;
+    stats->site = site;
+    stats->previous = NULL;
+    stats->next = site->live;
+    if (site->live != NULL)
+    {
+        site->live->previous = stats;
+    }
+    site->live = stats;
+}
+
+// called with the lock held
+DARRAY_INTERNAL void Darray_stats_unlink(DarrayStats *stats)
+{
+    if (stats->previous != NULL)
+    {
+        stats->previous->next = stats->next;
+    }
+    else
+    {
+        stats->site->live = stats->next;
+    }
+    if (stats->next != NULL)
+    {
+        stats->next->previous = stats->previous;
+    }
+}
+
+// the record is allocated with malloc, the allocator of the array may be an
+// arena or count its own bytes
+DARRAY_INTERNAL void Darray_stats_create(Darray *self)
+{
+    DarrayStats *stats = malloc(sizeof(DarrayStats));
+    *stats = (DarrayStats){
+        .element_size = self->element_size,
+        .peak_capacity = self->capacity,
+    };
+    pthread_mutex_lock(&Darray_stats_lock);
+    Darray_stats_link(stats, &Darray_stats_untracked);
+    pthread_mutex_unlock(&Darray_stats_lock);
+    self->stats = stats;
+}
+
+DARRAY_INTERNAL void Darray_stats_realloc(Darray *self)
+{
+    DarrayStats *stats = Darray_stats_of(self);
+    if (stats == NULL)
+    {
+        return;
+    }
+    __atomic_store_n(&stats->n_reallocs, stats->n_reallocs + 1,
+                     __ATOMIC_RELAXED);
+    size_t capacity = self->front_space + self->capacity;
+    if (capacity > stats->peak_capacity)
+    {
+        __atomic_store_n(&stats->peak_capacity, capacity, __ATOMIC_RELAXED);
+    }
+}
+
+// folds the counters of the array into its site
+DARRAY_INTERNAL void Darray_stats_release(Darray *self)
+{
+    DarrayStats *stats = Darray_stats_of(self);
+    if (stats == NULL)
+    {
+        return;
+    }
+    DarrayStatsSite *site = stats->site;
+    pthread_mutex_lock(&Darray_stats_lock);
+    Darray_stats_unlink(stats);
+    site->n_reallocs += stats->n_reallocs;
+    site->bytes_moved += stats->bytes_moved;
+    if (stats->peak_capacity > site->peak_capacity)
+    {
+        site->peak_capacity = stats->peak_capacity;
+    }
+    if (stats->peak_length > site->peak_length)
+    {
+        site->peak_length = stats->peak_length;
+    }
+    if (stats->peak_capacity > stats->peak_length)
+    {
+        site->slack_bytes +=
+            (stats->peak_capacity - stats->peak_length) * stats->element_size;
+    }
+    pthread_mutex_unlock(&Darray_stats_lock);
+    free(stats);
+}
+
+void *Darray_stats_attach(void *data, DarrayStatsSite *site)
+{
+    DarrayStats *stats = Darray_stats_of(GET_SELF(data));
+    if (stats == NULL)
+    {
+        return data;
+    }
+    pthread_mutex_lock(&Darray_stats_lock);
+    Darray_stats_unlink(stats);
+    stats->site->n_arrays -= 1;
+    Darray_stats_link(stats, site);
+    pthread_mutex_unlock(&Darray_stats_lock);
+    return data;
+}
+
+DarrayStats Darray_get_stats(void *data)
+{
+    DarrayStats *stats = Darray_stats_of(GET_SELF(data));
+    if (stats == NULL)
+    {
+        return (DarrayStats){0};
+    }
+    return *stats;
+}
+
+// slack is capacity that was allocated at the peak but never filled, summed
+// over the arrays of the site
+void Darray_stats_dump(FILE *stream)
+{
+    pthread_mutex_lock(&Darray_stats_lock);
+    fprintf(stream, "%-32s %8s %8s %10s %14s %12s %12s %14s\n", "site",
+            "arrays", "live", "reallocs", "bytes moved", "peak cap",
+            "peak len", "slack bytes");
+    for (DarrayStatsSite *site = Darray_stats_sites; site != NULL;
+         site = site->next)
+    {
+        size_t n_live = 0;
+        size_t n_reallocs = site->n_reallocs;
+        size_t bytes_moved = site->bytes_moved;
+        size_t peak_capacity = site->peak_capacity;
+        size_t peak_length = site->peak_length;
+        size_t slack_bytes = site->slack_bytes;
+        for (DarrayStats *stats = site->live; stats != NULL;
+             stats = stats->next)
+        {
+            size_t capacity = DARRAY_STATS_LOAD(stats->peak_capacity);
+            size_t length = DARRAY_STATS_LOAD(stats->peak_length);
+            n_live += 1;
+            n_reallocs += DARRAY_STATS_LOAD(stats->n_reallocs);
+            bytes_moved += DARRAY_STATS_LOAD(stats->bytes_moved);
+            peak_capacity = capacity > peak_capacity ? capacity : peak_capacity;
+            peak_length = length > peak_length ? length : peak_length;
+            slack_bytes +=
+                capacity > length ? (capacity - length) * stats->element_size
+                                  : 0;
+        }
+        char location[256];
+        snprintf(location, sizeof(location), "%s:%d", site->file, site->line);
+        fprintf(stream, "%-32s %8zu %8zu %10zu %14zu %12zu %12zu %14zu\n",
+                location, site->n_arrays, n_live, n_reallocs, bytes_moved,
+                peak_capacity, peak_length, slack_bytes);
+    }
+    pthread_mutex_unlock(&Darray_stats_lock);
+}
+
+#endif // #ifdef DARRAY_STATS
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+DARRAY_INTERNAL void Darray_set_front_space(Darray **self_p, void **data_p,
+                                            size_t new_front_space);
+
+DARRAY_INTERNAL void *Darray_init(Darray *self, size_t element_size,
+                                  size_t capacity, size_t flags,
+                                  malloc_t allocator, realloc_t reallocator,
+                                  free_t liberator)
+{
+    self->n_elements = 0;
+    self->element_size = element_size;
+    self->capacity = capacity;
+    self->reserve_space = capacity;
+    self->front_space = 0;
+    self->flags = flags;
+    self->growth = DARRAY_GROWTH_DOUBLE;
+    self->growth_increment = 0;
+    self->allocator = allocator;
+    self->reallocator = reallocator;
+    self->liberator = liberator;
+    self->arena = NULL;
+
+    return GET_DATA(self);
+}
+
+void *_Darray_create(size_t element_size, size_t initial_capacity,
+                     malloc_t allocator, realloc_t reallocator,
+                     free_t liberator)
+{
+    size_t size = element_size * initial_capacity + sizeof(Darray);
+    if (Darray_cache.budget > 0 && allocator == malloc &&
+        reallocator == realloc && liberator == free)
+    {
+        size_t class = Darray_cache_class(size);
+        Darray *self = Darray_cache_take(class);
+        if (self == NULL)
+        {
+            self = malloc((size_t)1 << class);
+        }
+        void *data = Darray_init(
+            self, element_size,
+            (((size_t)1 << class) - sizeof(Darray)) / element_size,
+            class << DARRAY_CACHE_CLASS_SHIFT, allocator, reallocator,
+            liberator);
+        self->reserve_space = initial_capacity;
+        DARRAY_STATS_CREATE(self);
+        return data;
+    }
+    Darray *self = allocator(size);
+    void *data = Darray_init(self, element_size, initial_capacity, 0,
+                             allocator, reallocator, liberator);
+    DARRAY_STATS_CREATE(self);
+    return data;
+}
+
+void *_Darray_create_aligned(size_t element_size, size_t initial_capacity,
+                             size_t alignment, malloc_t allocator,
+                             realloc_t reallocator, free_t liberator)
+{
+    size_t shift = 0;
+    while (((size_t)1 << shift) < alignment)
+    {
+        shift += 1;
+    }
+    alignment = (size_t)1 << shift;
+    void *allocation = allocator(alignment - 1 + sizeof(Darray) +
+                                 element_size * initial_capacity);
+    uintptr_t data = (uintptr_t)allocation + sizeof(Darray);
+    size_t padding = (alignment - data % alignment) % alignment;
+    Darray *self = allocation + padding;
+    Darray_init(self, element_size, initial_capacity,
+                shift << DARRAY_ALIGNMENT_SHIFT |
+                    padding << DARRAY_PADDING_SHIFT,
+                allocator, reallocator, liberator);
+    DARRAY_STATS_CREATE(self);
+    return GET_DATA(self);
+}
+
+void *_Darray_create_arena(size_t element_size, size_t initial_capacity,
+                           DarrayArena *arena)
+{
+    Darray *self = DarrayArena_alloc(arena, element_size * initial_capacity +
+                                                sizeof(Darray));
+    void *data = Darray_init(self, element_size, initial_capacity,
+                             DARRAY_FLAG_ARENA, NULL, NULL, NULL);
+    self->arena = arena;
+    return data;
+}
+
+// buffer must be aligned for both the header and the element type
+void *_Darray_create_buffer(size_t element_size, void *buffer,
+                            size_t buffer_size, malloc_t allocator,
+                            realloc_t reallocator, free_t liberator)
+{
+    return Darray_init(buffer, element_size,
+                       (buffer_size - sizeof(Darray)) / element_size,
+                       DARRAY_FLAG_BORROWED, allocator, reallocator, liberator);
+}
+
+void *_Darray_create_file(size_t element_size, size_t initial_capacity,
+                          const char *path)
+{
+#ifdef DARRAY_MAP
+    size_t size = sizeof(Darray) + initial_capacity * element_size;
+    int fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    void *base = MAP_FAILED;
+    if (ftruncate(fd, size) == 0)
+    {
+        base = mmap(NULL, DARRAY_MAP_SIZE(size), PROT_READ | PROT_WRITE,
+                    MAP_SHARED, fd, 0);
+    }
+    if (base == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    void *data = Darray_init(base, element_size, initial_capacity,
+                             DARRAY_FLAG_FILE, malloc, realloc, free);
+    ((Darray *)base)->fd = fd;
+    return data;
+#else
+    return NULL;
+#endif
+}
+
+void *_Darray_open_file(size_t element_size, const char *path)
+{
+#ifdef DARRAY_MAP
+    int fd = open(path, O_RDWR);
+    if (fd < 0)
+    {
+        return NULL;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Darray))
+    {
+        close(fd);
+        return NULL;
+    }
+    size_t size = info.st_size;
+    Darray *self = mmap(NULL, DARRAY_MAP_SIZE(size), PROT_READ | PROT_WRITE,
+                        MAP_SHARED, fd, 0);
+    if ((void *)self == MAP_FAILED)
+    {
+        close(fd);
+        return NULL;
+    }
+    if (self->element_size != element_size || self->front_space != 0 ||
+        !(self->flags & DARRAY_FLAG_FILE) ||
+        self->n_elements > self->capacity ||
+        sizeof(Darray) + self->capacity * element_size != size)
+    {
+        munmap(self, DARRAY_MAP_SIZE(size));
+        close(fd);
+        return NULL;
+    }
+    // the hooks and the descriptor of the process that wrote the file
+    self->allocator = malloc;
+    self->reallocator = realloc;
+    self->liberator = free;
+    self->fd = fd;
+    return GET_DATA(self);
+#else
+    return NULL;
+#endif
+}
+
+bool _Darray_sync(void **data_p)
+{
+#ifdef DARRAY_MAP
+    Darray *self = GET_SELF(*data_p);
+    if (!(self->flags & DARRAY_FLAG_FILE))
+    {
+        return false;
+    }
+    if (self->front_space != 0)
+    {
+        Darray_set_front_space(&self, data_p, 0);
+    }
+    return msync(self, DARRAY_MAP_SIZE(DARRAY_BLOCK_SIZE(self)), MS_SYNC) == 0;
+#else
+    return false;
+#endif
+}
+
+void Darray_destroy(void *data)
+{
+    Darray *self = GET_SELF(data);
+    if (self->flags & DARRAY_FLAG_BORROWED)
+    {
+        return;
+    }
+#ifdef DARRAY_MAP
+    if (self->flags & DARRAY_FLAG_FILE)
+    {
+        if (self->front_space != 0)
+        {
+            Darray_set_front_space(&self, &data, 0);
+        }
+        int fd = self->fd;
+        munmap(self, DARRAY_MAP_SIZE(DARRAY_BLOCK_SIZE(self)));
+        close(fd);
+        return;
+    }
+#endif
+    if (self->flags & DARRAY_FLAG_ARENA)
+    {
+        DarrayArena_free(self->arena, GET_BASE(self));
+        return;
+    }
+    DARRAY_STATS_RELEASE(self);
+    if (Darray_cache_eligible(self) && Darray_cache_put(self))
+    {
+        return;
+    }
+#ifdef DARRAY_MAP
+    if (self->flags & DARRAY_FLAG_MAPPED)
+    {
+        munmap(DARRAY_ALLOCATION(self),
+               DARRAY_MAP_SIZE(DARRAY_ALLOCATION_SIZE(self)));
+        return;
+    }
+#endif
+    self->liberator(DARRAY_ALLOCATION(self));
+}
+
+/* * * *  RESIZING  * * * */
+/* * * * (Internal) * * * */
+
+/*
+ * Memory layout of an array:
+ *
+ *   [ front_space slots ][ Darray header ][ gap ][ n_elements ][ free slots ]
+ *   ^ base               ^ self                  ^ data
+ *
+ * The front gap is only ever created by the *_beg functions, pushing to or
+ * popping from the beginning moves the payload start by element_size bytes
+ * and the header along with it instead of moving the whole payload, which
+ * makes them amortized O(1). The header stays on multiples of
+ * DARRAY_HEADER_ALIGNMENT from the base, what is left of the front gap lies
+ * between it and the payload, so the base has to be aligned for the header.
+ */
+
+// places the header in front of the payload of an array whose front gap
+// changed to new_front_space slots, neither the base nor the payload move
+DARRAY_INTERNAL Darray *Darray_move_header(Darray *self, size_t new_front_space)
+{
+    Darray *moved =
+        GET_BASE(self) +
+        DARRAY_HEADER_OFFSET(new_front_space * self->element_size);
+    if (moved != self)
+    {
+        memmove(moved, self, sizeof(Darray));
+    }
+    moved->front_space = new_front_space;
+    return moved;
+}
+
+// the allocator may return a differently aligned address, this moves the
+// block of an aligned array so that its payload is aligned again, only the
+// first kept elements survived the reallocation and are moved with it
+DARRAY_INTERNAL Darray *Darray_align(void *allocation, Darray *self,
+                                     size_t kept)
+{
+    size_t alignment = DARRAY_ALIGNMENT(self);
+    if (alignment == 1)
+    {
+        return self;
+    }
+    size_t front_bytes = self->front_space * self->element_size;
+    uintptr_t data = (uintptr_t)allocation + front_bytes + sizeof(Darray);
+    size_t padding = (alignment - data % alignment) % alignment;
+    if (padding == DARRAY_PADDING(self))
+    {
+        return self;
+    }
+    Darray *moved = allocation + padding + DARRAY_HEADER_OFFSET(front_bytes);
+    memmove(allocation + padding, GET_BASE(self),
+            front_bytes + sizeof(Darray) + kept * self->element_size);
+    moved->flags = (moved->flags & ~DARRAY_PADDING_MASK) |
+                   padding << DARRAY_PADDING_SHIFT;
+    return moved;
+}
+
+// reallocates the whole block so that new_capacity elements fit after the
+// header, the front gap is preserved
+DARRAY_INTERNAL void Darray_realloc(Darray **self_p, void **data_p,
+                                    size_t new_capacity)
+{
+    Darray *self = *self_p;
+    if (self->flags & DARRAY_FLAG_BORROWED)
+    {
+        // first growth out of the caller's buffer, the front gap is dropped
+        Darray *moved =
+            self->allocator(sizeof(Darray) + new_capacity * self->element_size);
+        memcpy(moved, self, sizeof(Darray));
+        memcpy((void *)moved + sizeof(Darray), GET_DATA(self),
+               self->n_elements * self->element_size);
+        moved->front_space = 0;
+        moved->flags &= ~DARRAY_FLAG_BORROWED;
+        moved->capacity = new_capacity;
+        (*self_p) = moved;
+        (*data_p) = GET_DATA(moved);
+        return;
+    }
+    // an aligned payload behind a gap that is not a multiple of the header
+    // alignment would leave the base unaligned for the header
+    if (DARRAY_ALIGNMENT(self) > 1 &&
+        DARRAY_HEADER_GAP(self->front_space * self->element_size) != 0)
+    {
+        Darray_set_front_space(&self, data_p, 0);
+    }
+    // arena and file storage is never aligned, the allocation is the block
+    size_t front_bytes = self->front_space * self->element_size;
+    size_t header_offset = DARRAY_HEADER_OFFSET(front_bytes);
+    size_t padding = DARRAY_PADDING(self);
+    size_t old_size = DARRAY_ALLOCATION_SIZE(self);
+    size_t new_size = DARRAY_ALIGNMENT(self) - 1 + front_bytes +
+                      sizeof(Darray) + new_capacity * self->element_size;
+    // a shrink never keeps more elements than the new block holds
+    size_t kept =
+        self->n_elements < new_capacity ? self->n_elements : new_capacity;
+    void *allocation = NULL;
+    if (self->flags & DARRAY_FLAG_ARENA)
+    {
+        allocation = DarrayArena_realloc(self->arena, GET_BASE(self),
+                                         old_size, new_size);
+    }
+#ifdef DARRAY_MAP
+    else if (self->flags & DARRAY_FLAG_FILE)
+    {
+        allocation = Darray_file_resize(self, old_size, new_size);
+    }
+    else if (self->flags & DARRAY_FLAG_MAPPED)
+    {
+        allocation = Darray_map_resize(DARRAY_ALLOCATION(self), old_size,
+                                       new_size, self->flags);
+        // a mapped block cannot be handed to the reallocator
+        if (allocation == NULL)
+        {
+            perror("Darray: could not remap a mapped array");
+            abort();
+        }
+    }
+    else if (new_size >= DARRAY_MAP_THRESHOLD && self->reallocator == realloc)
+    {
+        // the last copy this array will ever make
+        allocation = Darray_map(new_size, self->flags);
+        if (allocation != NULL)
+        {
+            memcpy(allocation + padding, GET_BASE(self),
+                   front_bytes + sizeof(Darray) + kept * self->element_size);
+            self->liberator(DARRAY_ALLOCATION(self));
+            ((Darray *)(allocation + padding + header_offset))->flags |=
+                DARRAY_FLAG_MAPPED;
+        }
+    }
+#endif
+    size_t cache_class = 0;
+    if (allocation == NULL && Darray_cache_eligible(self))
+    {
+        allocation = Darray_cache_resize(self, &new_capacity, &cache_class);
+    }
+    if (allocation == NULL)
+    {
+        allocation = self->reallocator(DARRAY_ALLOCATION(self), new_size);
+    }
+    self = Darray_align(allocation, allocation + padding + header_offset,
+                        kept);
+    self->capacity = new_capacity;
+    self->flags = (self->flags & ~DARRAY_CACHE_CLASS_MASK) |
+                  cache_class << DARRAY_CACHE_CLASS_SHIFT;
+    DARRAY_STATS_REALLOC(self);
+    (*self_p) = self;
+    (*data_p) = GET_DATA(self);
+}
+
+// slides header and payload inside the block so that there are exactly
+// new_front_space free slots in front of the header, no allocation
+DARRAY_INTERNAL void Darray_set_front_space(Darray **self_p, void **data_p,
+                                            size_t new_front_space)
+{
+    Darray *self = *self_p;
+    size_t total_space = self->front_space + self->capacity;
+    // header and payload move by different amounts when the gap between them
+    // changes, the header is kept aside while the payload moves
+    Darray header;
+    memcpy(&header, self, sizeof(Darray));
+    void *base = GET_BASE(self);
+    size_t front_bytes = new_front_space * self->element_size;
+    memmove(base + front_bytes + sizeof(Darray), GET_DATA(self),
+            self->n_elements * self->element_size);
+    Darray *moved = base + DARRAY_HEADER_OFFSET(front_bytes);
+    memcpy(moved, &header, sizeof(Darray));
+    DARRAY_STATS_MOVED(moved, moved->n_elements * moved->element_size);
+    moved->front_space = new_front_space;
+    moved->capacity = total_space - new_front_space;
+    (*self_p) = moved;
+    (*data_p) = GET_DATA(moved);
+}
+
+// smallest capacity reachable from the current one under the growth policy
+// of the array that holds at least needed elements
+DARRAY_INTERNAL size_t Darray_grown_capacity(Darray *self, size_t needed)
+{
+    size_t capacity = self->capacity == 0 ? 1 : self->capacity;
+    switch (self->growth)
+    {
+    case DARRAY_GROWTH_DOUBLE:
+        while (capacity < needed)
+        {
+            capacity *= 2;
+        }
+        return capacity;
+    case DARRAY_GROWTH_ONE_AND_HALF:
+        while (capacity < needed)
+        {
+            capacity += capacity / 2 + 1;
+        }
+        return capacity;
+    case DARRAY_GROWTH_PAGE:
+    {
+        // the whole block, front gap and header included, fills whole pages
+        size_t overhead =
+            sizeof(Darray) + self->front_space * self->element_size;
+        size_t bytes = overhead + needed * self->element_size;
+        bytes = (bytes + DARRAY_PAGE_SIZE - 1) / DARRAY_PAGE_SIZE *
+                DARRAY_PAGE_SIZE;
+        return (bytes - overhead) / self->element_size;
+    }
+    case DARRAY_GROWTH_FIXED:
+    {
+        size_t increment =
+            self->growth_increment == 0 ? 1 : self->growth_increment;
+        if (capacity < needed)
+        {
+            capacity += (needed - capacity + increment - 1) / increment *
+                        increment;
+        }
+        return capacity;
+    }
+    }
+    return needed;
+}
+
+DARRAY_INTERNAL void Darray_check_full_and_resize(Darray **self_p,
+                                                  void **data_p, size_t offset)
+{
+    Darray *self = *self_p;
+    DARRAY_STATS_LENGTH(self, self->n_elements + offset);
+    if (self->n_elements + offset < self->capacity)
+    {
+        return;
+    }
+    // a queue that has been popped from the front reuses that space, the
+    // copy is paid for by the pops that created the gap
+    if (self->front_space >= self->n_elements &&
+        self->n_elements + offset < self->front_space + self->capacity)
+    {
+        Darray_set_front_space(self_p, data_p, 0);
+        return;
+    }
+    Darray_realloc(self_p, data_p,
+                   Darray_grown_capacity(self, self->n_elements + offset + 1));
+}
+
+// makes room for at least offset elements in front of the header
+DARRAY_INTERNAL void Darray_check_front_and_resize(Darray **self_p,
+                                                   void **data_p, size_t offset)
+{
+    Darray *self = *self_p;
+    DARRAY_STATS_LENGTH(self, self->n_elements + offset);
+    if (self->front_space >= offset)
+    {
+        return;
+    }
+    // keep at least as much free space as there are elements so that the
+    // next relocation is amortized over as many front operations
+    size_t total_space = self->front_space + self->capacity;
+    size_t needed_space = 2 * (self->n_elements + offset) + 1;
+    if (total_space < needed_space)
+    {
+        size_t new_total_space = total_space == 0 ? 1 : total_space;
+        while (new_total_space < needed_space)
+        {
+            new_total_space *= 2;
+        }
+        Darray_realloc(self_p, data_p,
+                       new_total_space - (*self_p)->front_space);
+        self = *self_p;
+        total_space = self->front_space + self->capacity;
+    }
+    size_t free_space = total_space - self->n_elements;
+    Darray_set_front_space(self_p, data_p,
+                           offset + (free_space - offset) / 2);
+}
+
+// moves the payload to the start of the block and resizes it to exactly
+// new_capacity elements
+DARRAY_INTERNAL void Darray_shrink(Darray **self_p, void **data_p,
+                                   size_t new_capacity)
+{
+    if ((*self_p)->front_space != 0)
+    {
+        Darray_set_front_space(self_p, data_p, 0);
+    }
+    Darray_realloc(self_p, data_p, new_capacity);
+}
+
+// called after elements were removed from the array, so that a shrink copies
+// only the elements that are left
+DARRAY_INTERNAL void Darray_check_underused_and_resize(Darray **self_p,
+                                                       void **data_p)
+{
+    Darray *const self = *self_p;
+    // storage that is not ours to give back, or would not be given back
+    if (self->flags & (DARRAY_FLAG_BORROWED | DARRAY_FLAG_ARENA))
+    {
+        return;
+    }
+    size_t remaining = self->n_elements;
+    size_t total_space = self->front_space + self->capacity;
+    size_t new_capacity = 2 * remaining;
+    if (new_capacity < self->reserve_space)
+    {
+        new_capacity = self->reserve_space;
+    }
+    // shrink at a quarter, to a half: a full grow/shrink cycle takes at
+    // least as many operations as elements it copies
+    if (remaining > total_space / 4 || new_capacity >= total_space / 2)
+    {
+        return;
+    }
+    Darray_shrink(self_p, data_p, new_capacity);
+}
+
+// touches every page between the end of the payload and the end of the
+// first n slots so that the pushes up to there do not page fault
+DARRAY_INTERNAL void Darray_prefault(Darray *self, size_t n)
+{
+    if (n > self->capacity)
+    {
+        n = self->capacity;
+    }
+    if (n <= self->n_elements)
+    {
+        return;
+    }
+    void *start = GET_DATA(self) + self->n_elements * self->element_size;
+    void *end = GET_DATA(self) + n * self->element_size;
+#if defined(DARRAY_MAP) && defined(MADV_POPULATE_WRITE)
+    if (self->flags & DARRAY_FLAG_MAPPED)
+    {
+        void *page = DARRAY_ALLOCATION(self) +
+                     (start - DARRAY_ALLOCATION(self)) / DARRAY_PAGE_SIZE *
+                         DARRAY_PAGE_SIZE;
+        if (madvise(page, end - page, MADV_POPULATE_WRITE) == 0)
+        {
+            return;
+        }
+    }
+#endif
+    for (volatile char *p = start; (void *)p < end; p += DARRAY_PAGE_SIZE)
+    {
+        *p = 0;
+    }
+}
+
+/* * * * GETTERS * * * */
+
+size_t Darray_length(void *data)
+{
+    Darray *self = GET_SELF(data);
+    return self->n_elements;
+}
+
+size_t Darray_get_capacity(void *data)
+{
+    Darray *self = GET_SELF(data);
+    return self->capacity;
+}
+
+size_t Darray_get_reserve(void *data)
+{
+    Darray *self = GET_SELF(data);
+    return self->reserve_space;
+}
+
+void _Darray_reserve(void **data_p, size_t new_reserve_space)
+{
+    Darray *self = GET_SELF(*data_p);
+    if (new_reserve_space > self->capacity)
+    {
+        Darray_realloc(&self, data_p, new_reserve_space);
+    }
+    // also when the reserved space already fits in the capacity
+    if (self->flags & DARRAY_OPTION_PREFAULT)
+    {
+        Darray_prefault(self, new_reserve_space);
+    }
+    self->reserve_space = new_reserve_space;
+}
+
+void Darray_set_options(void *data, size_t options)
+{
+    Darray *self = GET_SELF(data);
+    self->flags = (self->flags & ~DARRAY_OPTIONS) | (options & DARRAY_OPTIONS);
+#ifdef DARRAY_MAP
+    if (self->flags & DARRAY_FLAG_MAPPED)
+    {
+        Darray_map_advise(DARRAY_ALLOCATION(self),
+                          DARRAY_ALLOCATION_SIZE(self), self->flags);
+    }
+#endif
+}
+
+void Darray_set_growth(void *data, DarrayGrowth growth, size_t increment)
+{
+    Darray *self = GET_SELF(data);
+    self->growth = growth;
+    self->growth_increment = increment;
+}
+
+// releases all unused space, front gap and reserve included
+void _Darray_shrink_to_fit(void **data_p)
+{
+    Darray *self = GET_SELF(*data_p);
+    if (self->flags & (DARRAY_FLAG_BORROWED | DARRAY_FLAG_ARENA))
+    {
+        return;
+    }
+    self->reserve_space = self->n_elements;
+    Darray_shrink(&self, data_p, self->n_elements);
+}
+
+// slow path of the typed functions, makes room for n more elements
+void _Darray_make_room(void **data_p, size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+    Darray_check_full_and_resize(&self, data_p, n);
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+void _Darray_push(void **data_p, void *element)
+{
+    Darray *self = GET_SELF(*data_p);
+    Darray_check_full_and_resize(&self, data_p, 1);
+    memcpy((*data_p) + (self->n_elements * self->element_size), element,
+           self->element_size);
+    self->n_elements += 1;
+}
+
+void _Darray_pop(void **data_p, void *out)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (self->n_elements == 0)
+    {
+        printf("Darray: pop function called upon empty array.\n");
+        return;
+    }
+#endif
+    if (out != NULL)
+    {
+        memcpy(out, (*data_p) + (self->n_elements - 1) * self->element_size,
+               self->element_size);
+    }
+    self->n_elements -= 1;
+    Darray_check_underused_and_resize(&self, data_p);
+}
+
+void _Darray_push_multiple(void **data_p, void *array, size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+    Darray_check_full_and_resize(&self, data_p, n);
+    memcpy((*data_p) + (self->n_elements * self->element_size), array,
+           n * self->element_size);
+    self->n_elements += n;
+}
+
+void _Darray_pop_multiple(void **data_p, void *out, size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (self->n_elements < n)
+    {
+        printf("Darray: refused to carry on with call to Darray_pop_multiple, "
+               "number "
+               "of elements to pop is greater than number of elements in the "
+               "array\n");
+        return;
+    }
+#endif
+    if (out != NULL)
+    {
+        memcpy(out, (*data_p) + (self->n_elements - n) * self->element_size,
+               n * self->element_size);
+    }
+    self->n_elements -= n;
+    Darray_check_underused_and_resize(&self, data_p);
+}
+
+void _Darray_push_middle(void **data_p, size_t index, void *element)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (index > self->n_elements - 1)
+    {
+        printf("Darray: refused to carry on with call to _Darray_push_middle, "
+               "index overflows array length\n");
+        return;
+    }
+#endif
+    Darray_check_full_and_resize(&self, data_p, 1);
+    void *middle_p = (*data_p) + index * self->element_size;
+    memmove(middle_p + self->element_size, middle_p,
+            (self->n_elements - index) * self->element_size);
+    DARRAY_STATS_MOVED(self, (self->n_elements - index) * self->element_size);
+    memcpy(middle_p, element, self->element_size);
+    self->n_elements += 1;
+}
+
+void _Darray_pop_middle(void **data_p, size_t index, void *out)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (index > self->n_elements - 1)
+    {
+        printf("Darray: refused to carry on with call to _Darray_pop_middle, "
                "index "
                "overflows array length\n");
         return;
     }
-#endif
-    void *middle_p = (*data_p) + index * self->element_size;
-    memmove(middle_p, middle_p + self->element_size,
-            (self->n_elements - index) * self->element_size);
-    Darray_check_underused_and_resize(&self, data_p, 1);
-    self->n_elements -= 1;
+#endif
+    void *middle_p = (*data_p) + index * self->element_size;
+    if (out != NULL)
+    {
+        memcpy(out, middle_p, self->element_size);
+    }
+    memmove(middle_p, middle_p + self->element_size,
+            (self->n_elements - index - 1) * self->element_size);
+    DARRAY_STATS_MOVED(self,
+                       (self->n_elements - index - 1) * self->element_size);
+    self->n_elements -= 1;
+    Darray_check_underused_and_resize(&self, data_p);
+}
+
+void _Darray_push_middle_multiple(void **data_p, size_t index, void *arr,
+                                  size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (index > self->n_elements - 1)
+    {
+        printf("Darray: refused to carry on with call to "
+               "_Darray_push_middle_multiple, index overflows array length\n");
+        return;
+    }
+#endif
+    Darray_check_full_and_resize(&self, data_p, n);
+    void *middle_p = (*data_p) + index * self->element_size;
+    memmove(middle_p + n * self->element_size, middle_p,
+            (self->n_elements - index) * self->element_size);
+    DARRAY_STATS_MOVED(self, (self->n_elements - index) * self->element_size);
+    memcpy(middle_p, arr, n * self->element_size);
+    self->n_elements += n;
+}
+
+void _Darray_pop_middle_multiple(void **data_p, size_t index, void *out,
+                                 size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (index > self->n_elements - 1)
+    {
+        printf("Darray: refused to carry on with call to "
+               "_Darray_pop_middle_multiple, index overflows array length\n");
+        return;
+    }
+    if (index + n > self->n_elements)
+    {
+        printf("Darray: refused to carry on with call to "
+               "_Darray_pop_middle_multiple, range overflows array length\n");
+        return;
+    }
+#endif
+    void *middle_p = (*data_p) + index * self->element_size;
+    if (out != NULL)
+    {
+        memcpy(out, middle_p, n * self->element_size);
+    }
+    memmove(middle_p, middle_p + n * self->element_size,
+            (self->n_elements - index - n) * self->element_size);
+    DARRAY_STATS_MOVED(self,
+                       (self->n_elements - index - n) * self->element_size);
+    self->n_elements -= n;
+    Darray_check_underused_and_resize(&self, data_p);
+}
+
+void _Darray_insert_batch(void **data_p, const size_t *indices,
+                          const void *values, size_t k)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    for (size_t j = 0; j < k; j++)
+    {
+        if (indices[j] > self->n_elements ||
+            (j > 0 && indices[j] < indices[j - 1]))
+        {
+            printf("Darray: refused to carry on with call to "
+                   "_Darray_insert_batch, indices are out of range or not "
+                   "ascending\n");
+            return;
+        }
+    }
+#endif
+    Darray_check_full_and_resize(&self, data_p, k);
+    size_t es = self->element_size;
+    char *data = *data_p;
+    // walking from the back, [0, source) is not moved yet and everything
+    // from destination on is in its final place
+    size_t source = self->n_elements;
+    size_t destination = self->n_elements + k;
+    for (size_t j = k; j-- > 0;)
+    {
+        size_t run = source - indices[j];
+        destination -= run;
+        source = indices[j];
+        memmove(data + destination * es, data + source * es, run * es);
+        DARRAY_STATS_MOVED(self, run * es);
+        destination -= 1;
+        memcpy(data + destination * es, (const char *)values + j * es, es);
+    }
+    self->n_elements += k;
+}
+
+void _Darray_push_beg(void **data_p, void *element)
+{
+    _Darray_push_beg_multiple(data_p, element, 1);
+}
+
+void _Darray_pop_beg(void **data_p, void *out)
+{
+    _Darray_pop_beg_multiple(data_p, out, 1);
+}
+
+void _Darray_push_beg_multiple(void **data_p, void *array, size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+    Darray_check_front_and_resize(&self, data_p, n);
+    Darray *moved = Darray_move_header(self, self->front_space - n);
+    moved->capacity += n;
+    moved->n_elements += n;
+    (*data_p) = GET_DATA(moved);
+    memcpy(*data_p, array, n * moved->element_size);
+}
+
+void _Darray_pop_beg_multiple(void **data_p, void *out, size_t n)
+{
+    Darray *self = GET_SELF(*data_p);
+#ifdef DARRAY_DEBUG
+    if (self->n_elements < n)
+    {
+        printf("Darray: refused to carry on with call to "
+               "Darray_pop_beg_multiple, number of elements to pop is greater "
+               "than number of elements in the array\n");
+        return;
+    }
+#endif
+    if (out != NULL)
+    {
+        memcpy(out, *data_p, n * self->element_size);
+    }
+    Darray *moved = Darray_move_header(self, self->front_space + n);
+    moved->capacity -= n;
+    moved->n_elements -= n;
+    (*data_p) = GET_DATA(moved);
+    Darray_check_underused_and_resize(&moved, data_p);
+}
+
+void _Darray_merge(void **dest, void *src)
+{
+    size_t len = Darray_length(src);
+    _Darray_push_multiple(dest, src, len);
+}
+
+void _Darray_merge_middle(void **dest, void *src, size_t index)
+{
+    size_t len = Darray_length(src);
+    _Darray_push_middle_multiple(dest, index, src, len);
+}
+
+void _Darray_merge_beg(void **dest, void *src, size_t index)
+{
+    size_t len = Darray_length(src);
+    _Darray_push_beg_multiple(dest, src, len);
+}
+
+/* * * * BULK REMOVAL * * * */
+
+// moves the kept elements in [run, end) down to write, returns the new write
+DARRAY_INTERNAL size_t Darray_compact_run(Darray *self, char *data,
+                                          size_t write, size_t run, size_t end)
+{
+    size_t element_size = self->element_size;
+    if (write != run)
+    {
+        memmove(data + write * element_size, data + run * element_size,
+                (end - run) * element_size);
+        DARRAY_STATS_MOVED(self, (end - run) * element_size);
+    }
+    return write + (end - run);
 }
 
-void _Darray_push_middle_multiple(void **data_p, size_t index, void *arr,
-                                  size_t n)
+DARRAY_INTERNAL size_t Darray_filter(void **data_p,
+                                     bool (*predicate)(const void *, void *),
+                                     void *context, bool remove_when)
 {
     Darray *self = GET_SELF(*data_p);
-#ifdef DARRAY_DEBUG
-    if (index > self->n_elements - 1)
+    size_t es = self->element_size;
+    char *data = *data_p;
+    size_t write = 0;
+    size_t run = 0; // first kept element that has not been moved yet
+    for (size_t i = 0; i < self->n_elements; i++)
     {
-        printf("Darray: refused to carry on with call to "
-               "_Darray_push_middle_multiple, index overflows array length\n");
-        return;
+        if (predicate(data + i * es, context) == remove_when)
+        {
+            write = Darray_compact_run(self, data, write, run, i);
+            run = i + 1;
+        }
     }
-#endif
-    Darray_check_full_and_resize(&self, data_p, n);
-    void *middle_p = (*data_p) + index * self->element_size;
-    memmove(middle_p + n * self->element_size, middle_p,
-            (self->n_elements - index) * self->element_size);
-    memcpy(middle_p, arr, n * self->element_size);
-    self->n_elements += n;
+    write = Darray_compact_run(self, data, write, run, self->n_elements);
+    size_t removed = self->n_elements - write;
+    if (removed > 0)
+    {
+        self->n_elements -= removed;
+        Darray_check_underused_and_resize(&self, data_p);
+    }
+    return removed;
 }
 
-void _Darray_pop_middle_multiple(void **data_p, size_t index, void *out,
-                                 size_t n)
+size_t _Darray_remove_if(void **data_p, bool (*predicate)(const void *, void *),
+                         void *context)
+{
+    return Darray_filter(data_p, predicate, context, true);
+}
+
+size_t _Darray_retain(void **data_p, bool (*predicate)(const void *, void *),
+                      void *context)
+{
+    return Darray_filter(data_p, predicate, context, false);
+}
+
+size_t _Darray_remove_indices(void **data_p, const size_t *indices, size_t n)
 {
     Darray *self = GET_SELF(*data_p);
 #ifdef DARRAY_DEBUG
-    if (index > self->n_elements - 1)
+    for (size_t k = 0; k < n; k++)
     {
-        printf("Darray: refused to carry on with call to "
-               "_Darray_pop_middle_multiple, index overflows array length\n");
-        return;
+        if (indices[k] >= self->n_elements ||
+            (k > 0 && indices[k] <= indices[k - 1]))
+        {
+            printf("Darray: refused to carry on with call to "
+                   "_Darray_remove_indices, indices are out of range or not "
+                   "strictly ascending\n");
+            return 0;
+        }
+    }
+#endif
+    if (n == 0)
+    {
+        return 0;
     }
-    if (n > self->n_elements)
+    size_t es = self->element_size;
+    char *data = *data_p;
+    size_t write = indices[0];
+    size_t run = indices[0] + 1;
+    for (size_t k = 1; k < n; k++)
     {
+        write = Darray_compact_run(self, data, write, run, indices[k]);
+        run = indices[k] + 1;
     }
-#endif
-    void *middle_p = (*data_p) + index * self->element_size;
-    memmove(middle_p, middle_p + n * self->element_size,
-            (self->n_elements - index) * self->element_size);
-    Darray_check_underused_and_resize(&self, data_p, n);
+    Darray_compact_run(self, data, write, run, self->n_elements);
     self->n_elements -= n;
+    Darray_check_underused_and_resize(&self, data_p);
+    return n;
 }
 
-void _Darray_push_beg(void **data_p, void *element)
+void _Darray_swap_remove(void **data_p, size_t index, void *out)
 {
     Darray *self = GET_SELF(*data_p);
-    Darray_check_full_and_resize(&self, data_p, 1);
-    memmove(*data_p + self->element_size, *data_p,
-            self->n_elements * self->element_size);
-    memcpy(*data_p, element, self->element_size);
-    self->n_elements += 1;
+#ifdef DARRAY_DEBUG
+    if (index >= self->n_elements)
+    {
+        printf("Darray: refused to carry on with call to _Darray_swap_remove, "
+               "index overflows array length\n");
+        return;
+    }
+#endif
+    size_t es = self->element_size;
+    void *hole = (*data_p) + index * es;
+    if (out != NULL)
+    {
+        memcpy(out, hole, es);
+    }
+    if (index != self->n_elements - 1)
+    {
+        memcpy(hole, (*data_p) + (self->n_elements - 1) * es, es);
+    }
+    self->n_elements -= 1;
+    Darray_check_underused_and_resize(&self, data_p);
 }
 
-void _Darray_pop_beg(void **data_p, void *out)
+void *Darray_split_copy(void *data, size_t start_index, size_t end_index)
 {
-    Darray *self = GET_SELF(*data_p);
-    if (out != NULL)
+    Darray *self = GET_SELF(data);
+    size_t new_array_size = end_index - start_index;
+    void *result;
+    if (self->flags & DARRAY_FLAG_ARENA)
+    {
+        result = _Darray_create_arena(self->element_size, new_array_size,
+                                      self->arena);
+    }
+    else
     {
-        memcpy(out, *data_p, self->element_size);
+        result =
+            _Darray_create(self->element_size, new_array_size, self->allocator,
+                           self->reallocator, self->liberator);
+    }
+    _Darray_push_multiple(&result, data + start_index * self->element_size,
+                          new_array_size);
+    return result;
+}
+
+void *Darray_split(void *data, size_t start_index, size_t end_index)
+{
+    return Darray_split_copy(data, start_index, end_index);
+}
+
+/* * * * SEARCH AND REDUCTION * * * */
+
+#if defined(__x86_64__) && defined(__linux__) && defined(__GNUC__) &&         \
+    !defined(DARRAY_NO_SIMD)
+#define DARRAY_SIMD_TARGETS                                                    \
+    __attribute__((                                                            \
+        target_clones("arch=x86-64-v4", "arch=x86-64-v3", "default")))
+#else
+#define DARRAY_SIMD_TARGETS
+#endif
+
+#ifdef DARRAY_NO_SIMD
+#define DARRAY_SIMD_ENABLED 0
+#else
+#define DARRAY_SIMD_ENABLED 1
+#endif
+
+// one AVX-512 register, two AVX2 or four SSE registers
+#define DARRAY_SIMD_BYTES 64
+
+typedef uint64_t DarrayMask_any
+    __attribute__((vector_size(DARRAY_SIMD_BYTES)));
+
+#define DARRAY_SIMD_ANY(mask)                                                  \
+    ((mask)[0] | (mask)[1] | (mask)[2] | (mask)[3] | (mask)[4] | (mask)[5] |   \
+     (mask)[6] | (mask)[7])
+
+// name, type tag, element type, mask lane type, sum type
+#define DARRAY_SIMD_TYPES(X)                                                   \
+    X(i8, DARRAY_I8, int8_t, int8_t, int64_t)                                  \
+    X(u8, DARRAY_U8, uint8_t, int8_t, uint64_t)                                \
+    X(i16, DARRAY_I16, int16_t, int16_t, int64_t)                              \
+    X(u16, DARRAY_U16, uint16_t, int16_t, uint64_t)                            \
+    X(i32, DARRAY_I32, int32_t, int32_t, int64_t)                              \
+    X(u32, DARRAY_U32, uint32_t, int32_t, uint64_t)                            \
+    X(i64, DARRAY_I64, int64_t, int64_t, int64_t)                              \
+    X(u64, DARRAY_U64, uint64_t, int64_t, uint64_t)                            \
+    X(f32, DARRAY_F32, float, int32_t, double)                                 \
+    X(f64, DARRAY_F64, double, int64_t, double)
+
+#define DARRAY_SIMD_EXTREME(name, function, T, M, CMP)                         \
+    DARRAY_SIMD_TARGETS static T Darray_##function##_##name(const T *data,     \
+                                                            size_t n)          \
+    {                                                                          \
+        const size_t lanes = DARRAY_SIMD_BYTES / sizeof(T);                    \
+        T result = data[0];                                                    \
+        size_t i = 0;                                                          \
+        if (DARRAY_SIMD_ENABLED && n >= lanes)                                 \
+        {                                                                      \
+            DarrayVec_##name best;                                             \
+            memcpy(&best, data, sizeof best);                                  \
+            for (i = lanes; i + lanes <= n; i += lanes)                        \
+            {                                                                  \
+                DarrayVec_##name block;                                        \
+                memcpy(&block, data + i, sizeof block);                        \
+                DarrayMask_##name take = block CMP best;                       \
+                best = (DarrayVec_##name)(((DarrayMask_##name)block & take) |  \
+                                          ((DarrayMask_##name)best & ~take));  \
+            }                                                                  \
+            for (size_t lane = 0; lane < lanes; lane++)                        \
+            {                                                                  \
+                if (best[lane] CMP result)                                     \
+                {                                                              \
+                    result = best[lane];                                       \
+                }                                                              \
+            }                                                                  \
+        }                                                                      \
+        for (; i < n; i++)                                                     \
+        {                                                                      \
+            if (data[i] CMP result)                                            \
+            {                                                                  \
+                result = data[i];                                              \
+            }                                                                  \
+        }                                                                      \
+        return result;                                                         \
     }
+
+#define DARRAY_SIMD_KERNELS(name, tag, T, M, S)                                \
+    typedef T DarrayVec_##name                                                 \
+        __attribute__((vector_size(DARRAY_SIMD_BYTES)));                       \
+    typedef M DarrayMask_##name                                                \
+        __attribute__((vector_size(DARRAY_SIMD_BYTES)));                       \
+    typedef T DarrayVec8_##name __attribute__((vector_size(8 * sizeof(T))));   \
+    typedef S DarraySum8_##name __attribute__((vector_size(8 * sizeof(S))));   \
+                                                                               \
+    DARRAY_SIMD_TARGETS static size_t Darray_find_##name(const T *data,        \
+                                                         size_t n, T value)    \
+    {                                                                          \
+        const size_t lanes = DARRAY_SIMD_BYTES / sizeof(T);                    \
+        size_t i = 0;                                                          \
+        for (; DARRAY_SIMD_ENABLED && i + lanes <= n; i += lanes)              \
+        {                                                                      \
+            DarrayVec_##name block;                                            \
+            memcpy(&block, data + i, sizeof block);                            \
+            DarrayMask_any hits = (DarrayMask_any)(block == value);            \
+            if (DARRAY_SIMD_ANY(hits))                                         \
+            {                                                                  \
+                break;                                                         \
+            }                                                                  \
+        }                                                                      \
+        for (; i < n; i++)                                                     \
+        {                                                                      \
+            if (data[i] == value)                                              \
+            {                                                                  \
+                return i;                                                      \
+            }                                                                  \
+        }                                                                      \
+        return -1;                                                             \
+    }                                                                          \
+                                                                               \
+    DARRAY_SIMD_TARGETS static size_t Darray_count_##name(const T *data,       \
+                                                          size_t n, T value)   \
+    {                                                                          \
+        const size_t lanes = DARRAY_SIMD_BYTES / sizeof(T);                    \
+        size_t result = 0;                                                     \
+        size_t i = 0;                                                          \
+        while (DARRAY_SIMD_ENABLED && i + lanes <= n)                          \
+        {                                                                      \
+            /* comparisons give -1 per hit, flush before 8 bit lanes wrap */   \
+            DarrayMask_##name hits = {0};                                      \
+            for (size_t k = 0; k < 127 && i + lanes <= n; k++, i += lanes)     \
+            {                                                                  \
+                DarrayVec_##name block;                                        \
+                memcpy(&block, data + i, sizeof block);                        \
+                hits -= block == value;                                        \
+            }                                                                  \
+            for (size_t lane = 0; lane < lanes; lane++)                        \
+            {                                                                  \
+                result += hits[lane];                                          \
+            }                                                                  \
+        }                                                                      \
+        for (; i < n; i++)                                                     \
+        {                                                                      \
+            result += data[i] == value;                                        \
+        }                                                                      \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    DARRAY_SIMD_TARGETS static S Darray_sum_##name(const T *data, size_t n)    \
+    {                                                                          \
+        S result = 0;                                                          \
+        size_t i = 0;                                                          \
+        if (DARRAY_SIMD_ENABLED)                                               \
+        {                                                                      \
+            DarraySum8_##name sums = {0};                                      \
+            for (; i + 8 <= n; i += 8)                                         \
+            {                                                                  \
+                DarrayVec8_##name block;                                       \
+                memcpy(&block, data + i, sizeof block);                        \
+                sums += __builtin_convertvector(block, DarraySum8_##name);     \
+            }                                                                  \
+            for (size_t lane = 0; lane < 8; lane++)                            \
+            {                                                                  \
+                result += sums[lane];                                          \
+            }                                                                  \
+        }                                                                      \
+        for (; i < n; i++)                                                     \
+        {                                                                      \
+            result += data[i];                                                 \
+        }                                                                      \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    DARRAY_SIMD_EXTREME(name, min, T, M, <)                                    \
+    DARRAY_SIMD_EXTREME(name, max, T, M, >)
+
+DARRAY_SIMD_TYPES(DARRAY_SIMD_KERNELS)
+
+DARRAY_INTERNAL void Darray_check_type(size_t element_size, DarrayType type)
+{
 #ifdef DARRAY_DEBUG
-    if (self->n_elements == 0)
+    static const size_t sizes[] = {1, 1, 2, 2, 4, 4, 8, 8, 4, 8};
+    if (element_size != sizes[type])
     {
+        printf("Darray: element type passed to a search or reduction does not "
+               "match the element size of the array\n");
     }
 #endif
-    memmove(*data_p, *data_p + self->element_size,
-            (self->n_elements - 1) * self->element_size);
-    Darray_check_underused_and_resize(&self, data_p, 1);
-    self->n_elements -= 1;
 }
 
-void _Darray_push_beg_multiple(void **data_p, void *array, size_t n)
+#define DARRAY_FIND_CASE(name, tag, T, M, S)                                   \
+    case tag:                                                                  \
+        return Darray_find_##name(data, n, *(const T *)value);
+#define DARRAY_COUNT_CASE(name, tag, T, M, S)                                  \
+    case tag:                                                                  \
+        return Darray_count_##name(data, n, *(const T *)value);
+#define DARRAY_MIN_CASE(name, tag, T, M, S)                                    \
+    case tag:                                                                  \
+        *(T *)out = Darray_min_##name(data, n);                                \
+        return true;
+#define DARRAY_MAX_CASE(name, tag, T, M, S)                                    \
+    case tag:                                                                  \
+        *(T *)out = Darray_max_##name(data, n);                                \
+        return true;
+#define DARRAY_SUM_CASE(name, tag, T, M, S)                                    \
+    case tag:                                                                  \
+        *(S *)out = Darray_sum_##name(data, n);                                \
+        return;
+
+// the dispatchers work on any n elements, shared by arrays and slices
+
+DARRAY_INTERNAL size_t Darray_find_elements(const void *data, size_t n,
+                                            DarrayType type, const void *value)
 {
-    Darray *self = GET_SELF(*data_p);
-    Darray_check_full_and_resize(&self, data_p, n);
-    memmove(*data_p + n * self->element_size, *data_p,
-            self->n_elements * self->element_size);
-    memcpy(*data_p, array, n * self->element_size);
-    self->n_elements += n;
+    switch (type)
+    {
+        DARRAY_SIMD_TYPES(DARRAY_FIND_CASE)
+    }
+    return -1;
 }
 
-void _Darray_pop_beg_multiple(void **data_p, void *out, size_t n)
+DARRAY_INTERNAL size_t Darray_count_elements(const void *data, size_t n,
+                                             DarrayType type,
+                                             const void *value)
 {
-    Darray *self = GET_SELF(*data_p);
-    if (out != NULL)
+    switch (type)
     {
-        memcpy(out, *data_p, n * self->n_elements);
+        DARRAY_SIMD_TYPES(DARRAY_COUNT_CASE)
     }
-#ifdef DARRAY_DEBUG
-#endif
-    memmove(*data_p, *data_p + n * self->element_size,
-            (self->n_elements - n) * self->n_elements);
-    Darray_check_underused_and_resize(&self, data_p, n);
-    self->n_elements -= n;
+    return 0;
 }
 
-void _Darray_merge(void **dest, void *src)
+DARRAY_INTERNAL bool Darray_min_elements(const void *data, size_t n,
+                                         DarrayType type, void *out)
 {
-    size_t len = Darray_length(src);
-    _Darray_push_multiple(dest, src, len);
+    if (n == 0)
+    {
+        return false;
+    }
+    switch (type)
+    {
+        DARRAY_SIMD_TYPES(DARRAY_MIN_CASE)
+    }
+    return false;
 }
 
-void _Darray_merge_middle(void **dest, void *src, size_t index)
+DARRAY_INTERNAL bool Darray_max_elements(const void *data, size_t n,
+                                         DarrayType type, void *out)
 {
-    size_t len = Darray_length(src);
-    _Darray_push_middle_multiple(dest, index, src, len);
+    if (n == 0)
+    {
+        return false;
+    }
+    switch (type)
+    {
+        DARRAY_SIMD_TYPES(DARRAY_MAX_CASE)
+    }
+    return false;
 }
 
-void _Darray_merge_beg(void **dest, void *src, size_t index)
+DARRAY_INTERNAL void Darray_sum_elements(const void *data, size_t n,
+                                         DarrayType type, void *out)
 {
-    size_t len = Darray_length(src);
-    _Darray_push_beg_multiple(dest, src, len);
+    switch (type)
+    {
+        DARRAY_SIMD_TYPES(DARRAY_SUM_CASE)
+    }
 }
 
-void *Darray_split(void *data, size_t start_index, size_t end_index)
+size_t Darray_find(void *data, DarrayType type, const void *value)
+{
+    Darray_check_type((GET_SELF(data))->element_size, type);
+    return Darray_find_elements(data, Darray_length(data), type, value);
+}
+
+size_t Darray_count(void *data, DarrayType type, const void *value)
+{
+    Darray_check_type((GET_SELF(data))->element_size, type);
+    return Darray_count_elements(data, Darray_length(data), type, value);
+}
+
+bool Darray_contains(void *data, DarrayType type, const void *value)
+{
+    return Darray_find(data, type, value) != (size_t)-1;
+}
+
+bool Darray_min(void *data, DarrayType type, void *out)
+{
+    Darray_check_type((GET_SELF(data))->element_size, type);
+    return Darray_min_elements(data, Darray_length(data), type, out);
+}
+
+bool Darray_max(void *data, DarrayType type, void *out)
+{
+    Darray_check_type((GET_SELF(data))->element_size, type);
+    return Darray_max_elements(data, Darray_length(data), type, out);
+}
+
+void Darray_sum(void *data, DarrayType type, void *out)
+{
+    Darray_check_type((GET_SELF(data))->element_size, type);
+    Darray_sum_elements(data, Darray_length(data), type, out);
+}
+
+/* * * * SLICES * * * */
+
+DarraySlice Darray_slice(void *data, size_t start_index, size_t end_index)
 {
     Darray *self = GET_SELF(data);
-    size_t new_array_size = end_index - start_index;
+#ifdef DARRAY_DEBUG
+    if (start_index > end_index || end_index > self->n_elements)
+    {
+        printf("Darray: refused to carry on with call to Darray_slice, range "
+               "overflows array length\n");
+        end_index = start_index;
+    }
+#endif
+    DarraySlice slice = {
+        .data = data + start_index * self->element_size,
+        .length = end_index - start_index,
+        .element_size = self->element_size,
+    };
+    return slice;
+}
+
+DarraySlice DarraySlice_slice(DarraySlice slice, size_t start_index,
+                              size_t end_index)
+{
+#ifdef DARRAY_DEBUG
+    if (start_index > end_index || end_index > slice.length)
+    {
+        printf("Darray: refused to carry on with call to DarraySlice_slice, "
+               "range overflows slice length\n");
+        end_index = start_index;
+    }
+#endif
+    slice.data += start_index * slice.element_size;
+    slice.length = end_index - start_index;
+    return slice;
+}
+
+void *DarraySlice_to_Darray(DarraySlice slice)
+{
     void *result =
-        _Darray_create(self->element_size, new_array_size, self->allocator,
-                       self->reallocator, self->liberator);
-    _Darray_push_multiple(&result, data + start_index * self->element_size,
-                          new_array_size);
+        _Darray_create(slice.element_size, slice.length, malloc, realloc, free);
+    _Darray_push_multiple(&result, slice.data, slice.length);
     return result;
 }
 
+size_t DarraySlice_find(DarraySlice slice, DarrayType type, const void *value)
+{
+    Darray_check_type(slice.element_size, type);
+    return Darray_find_elements(slice.data, slice.length, type, value);
+}
+
+size_t DarraySlice_count(DarraySlice slice, DarrayType type, const void *value)
+{
+    Darray_check_type(slice.element_size, type);
+    return Darray_count_elements(slice.data, slice.length, type, value);
+}
+
+bool DarraySlice_contains(DarraySlice slice, DarrayType type,
+                          const void *value)
+{
+    return DarraySlice_find(slice, type, value) != (size_t)-1;
+}
+
+bool DarraySlice_min(DarraySlice slice, DarrayType type, void *out)
+{
+    Darray_check_type(slice.element_size, type);
+    return Darray_min_elements(slice.data, slice.length, type, out);
+}
+
+bool DarraySlice_max(DarraySlice slice, DarrayType type, void *out)
+{
+    Darray_check_type(slice.element_size, type);
+    return Darray_max_elements(slice.data, slice.length, type, out);
+}
+
+void DarraySlice_sum(DarraySlice slice, DarrayType type, void *out)
+{
+    Darray_check_type(slice.element_size, type);
+    Darray_sum_elements(slice.data, slice.length, type, out);
+}
+
+/* * * * SORTING * * * */
+
+// temporary memory taken from wherever the array itself gets its memory
+DARRAY_INTERNAL void *Darray_scratch_alloc(Darray *self, size_t size)
+{
+    if (self->flags & DARRAY_FLAG_ARENA)
+    {
+        return DarrayArena_alloc(self->arena, size);
+    }
+    return self->allocator(size);
+}
+
+DARRAY_INTERNAL void Darray_scratch_free(Darray *self, void *scratch)
+{
+    if (self->flags & DARRAY_FLAG_ARENA)
+    {
+        DarrayArena_free(self->arena, scratch);
+        return;
+    }
+    self->liberator(scratch);
+}
+
+// key modes: the bits are an unsigned, a two's complement or an IEEE 754 key
+#define DARRAY_RADIX_UNSIGNED 0
+#define DARRAY_RADIX_SIGNED 1
+#define DARRAY_RADIX_FLOAT 2
+
+// keys are first mapped to unsigned integers that sort in the same order,
+// then sorted one byte at a time, bytes where all keys agree are skipped
+#define DARRAY_RADIX_SORT(bits)                                                \
+    static void Darray_radix_sort_##bits(uint##bits##_t *data,                 \
+                                         uint##bits##_t *buffer, size_t n,     \
+                                         int mode)                             \
+    {                                                                          \
+        const uint##bits##_t sign = (uint##bits##_t)1 << (bits - 1);           \
+        size_t counts[bits / 8][256] = {{0}};                                  \
+        for (size_t i = 0; i < n; i++)                                         \
+        {                                                                      \
+            uint##bits##_t key = data[i];                                      \
+            if (mode == DARRAY_RADIX_SIGNED)                                   \
+            {                                                                  \
+                key ^= sign;                                                   \
+            }                                                                  \
+            else if (mode == DARRAY_RADIX_FLOAT)                               \
+            {                                                                  \
+                key = (key & sign) ? (uint##bits##_t)~key : key | sign;        \
+            }                                                                  \
+            data[i] = key;                                                     \
+            for (size_t byte = 0; byte < bits / 8; byte++)                     \
+            {                                                                  \
+                counts[byte][(key >> (8 * byte)) & 0xff] += 1;                 \
+            }                                                                  \
+        }                                                                      \
+        uint##bits##_t *from = data;                                           \
+        uint##bits##_t *to = buffer;                                           \
+        for (size_t byte = 0; byte < bits / 8; byte++)                         \
+        {                                                                      \
+            size_t *count = counts[byte];                                      \
+            if (count[(from[0] >> (8 * byte)) & 0xff] == n)                    \
+            {                                                                  \
+                continue;                                                      \
+            }                                                                  \
+            size_t offset = 0;                                                 \
+            for (size_t digit = 0; digit < 256; digit++)                       \
+            {                                                                  \
+                size_t digit_count = count[digit];                             \
+                count[digit] = offset;                                         \
+                offset += digit_count;                                         \
+            }                                                                  \
+            for (size_t i = 0; i < n; i++)                                     \
+            {                                                                  \
+                to[count[(from[i] >> (8 * byte)) & 0xff]++] = from[i];         \
+            }                                                                  \
+            uint##bits##_t *swap = from;                                       \
+            from = to;                                                         \
+            to = swap;                                                         \
+        }                                                                      \
+        if (from != data)                                                      \
+        {                                                                      \
+            memcpy(data, from, n * sizeof(uint##bits##_t));                    \
+        }                                                                      \
+        for (size_t i = 0; i < n; i++)                                         \
+        {                                                                      \
+            uint##bits##_t key = data[i];                                      \
+            if (mode == DARRAY_RADIX_SIGNED)                                   \
+            {                                                                  \
+                key ^= sign;                                                   \
+            }                                                                  \
+            else if (mode == DARRAY_RADIX_FLOAT)                               \
+            {                                                                  \
+                key = (key & sign) ? key ^ sign : (uint##bits##_t)~key;        \
+            }                                                                  \
+            data[i] = key;                                                     \
+        }                                                                      \
+    }
+
+DARRAY_RADIX_SORT(8)
+DARRAY_RADIX_SORT(16)
+DARRAY_RADIX_SORT(32)
+DARRAY_RADIX_SORT(64)
+
+void Darray_sort(void *data, DarrayType type)
+{
+    static const int modes[] = {
+        DARRAY_RADIX_SIGNED, DARRAY_RADIX_UNSIGNED, DARRAY_RADIX_SIGNED,
+        DARRAY_RADIX_UNSIGNED, DARRAY_RADIX_SIGNED, DARRAY_RADIX_UNSIGNED,
+        DARRAY_RADIX_SIGNED, DARRAY_RADIX_UNSIGNED, DARRAY_RADIX_FLOAT,
+        DARRAY_RADIX_FLOAT,
+    };
+    Darray *self = GET_SELF(data);
+    Darray_check_type(self->element_size, type);
+    if (self->n_elements < 2)
+    {
+        return;
+    }
+    void *buffer =
+        Darray_scratch_alloc(self, self->n_elements * self->element_size);
+    switch (self->element_size)
+    {
+    case 1:
+        Darray_radix_sort_8(data, buffer, self->n_elements, modes[type]);
+        break;
+    case 2:
+        Darray_radix_sort_16(data, buffer, self->n_elements, modes[type]);
+        break;
+    case 4:
+        Darray_radix_sort_32(data, buffer, self->n_elements, modes[type]);
+        break;
+    case 8:
+        Darray_radix_sort_64(data, buffer, self->n_elements, modes[type]);
+        break;
+    }
+    Darray_scratch_free(self, buffer);
+}
+
+typedef int (*DarrayCompare)(const void *, const void *);
+
+// below this many elements partitions are finished with insertion sort
+#define DARRAY_SORT_INSERTION_THRESHOLD 24
+// partial insertion sort gives up after this many moved elements
+#define DARRAY_SORT_PARTIAL_LIMIT 8
+
+/*
+ * Introsort with the pattern defeating tricks of pdqsort: median of three or
+ * ninther pivots, an O(n) exit for already partitioned ranges, element
+ * shuffles after unbalanced partitions and heapsort once too many of those
+ * happened. suffix names the instantiation, ES is the element size, constant
+ * in the specialized versions so that SWAP compiles to plain moves.
+ */
+#define DARRAY_SORT_FUNCTIONS(suffix, ES, SWAP)                                \
+    static void Darray_insertion_sort_##suffix(char *first, char *last,        \
+                                               size_t es,                      \
+                                               DarrayCompare compare)          \
+    {                                                                          \
+        for (char *i = first + ES; i < last; i += ES)                          \
+        {                                                                      \
+            for (char *j = i; j > first && compare(j - ES, j) > 0; j -= ES)    \
+            {                                                                  \
+                SWAP(j - ES, j);                                               \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static bool Darray_partial_insertion_sort_##suffix(                        \
+        char *first, char *last, size_t es, DarrayCompare compare)             \
+    {                                                                          \
+        size_t moves = 0;                                                      \
+        for (char *i = first + ES; i < last; i += ES)                          \
+        {                                                                      \
+            for (char *j = i; j > first && compare(j - ES, j) > 0; j -= ES)    \
+            {                                                                  \
+                SWAP(j - ES, j);                                               \
+                moves += 1;                                                    \
+            }                                                                  \
+            if (moves > DARRAY_SORT_PARTIAL_LIMIT)                             \
+            {                                                                  \
+                return false;                                                  \
+            }                                                                  \
+        }                                                                      \
+        return true;                                                           \
+    }                                                                          \
+                                                                               \
+    static void Darray_heap_sort_##suffix(char *first, size_t n, size_t es,    \
+                                          DarrayCompare compare)               \
+    {                                                                          \
+        for (size_t end = n, start = n / 2; end > 1;)                          \
+        {                                                                      \
+            if (start > 0)                                                     \
+            {                                                                  \
+                start -= 1;                                                    \
+            }                                                                  \
+            else                                                               \
+            {                                                                  \
+                end -= 1;                                                      \
+                SWAP(first, first + end * ES);                                 \
+            }                                                                  \
+            size_t root = start;                                               \
+            while (2 * root + 1 < end)                                         \
+            {                                                                  \
+                size_t child = 2 * root + 1;                                   \
+                if (child + 1 < end && compare(first + child * ES,             \
+                                               first + (child + 1) * ES) < 0)  \
+                {                                                              \
+                    child += 1;                                                \
+                }                                                              \
+                if (compare(first + root * ES, first + child * ES) >= 0)       \
+                {                                                              \
+                    break;                                                     \
+                }                                                              \
+                SWAP(first + root * ES, first + child * ES);                   \
+                root = child;                                                  \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    static void Darray_sort3_##suffix(char *a, char *b, char *c, size_t es,    \
+                                      DarrayCompare compare)                   \
+    {                                                                          \
+        if (compare(b, a) < 0)                                                 \
+        {                                                                      \
+            SWAP(a, b);                                                        \
+        }                                                                      \
+        if (compare(c, b) < 0)                                                 \
+        {                                                                      \
+            SWAP(b, c);                                                        \
+            if (compare(b, a) < 0)                                             \
+            {                                                                  \
+                SWAP(a, b);                                                    \
+            }                                                                  \
+        }                                                                      \
+    }                                                                          \
+                                                                               \
+    /* the pivot is at first, returns its final position */                   \
+    static char *Darray_partition_##suffix(char *first, char *last,            \
+                                           size_t es, DarrayCompare compare,   \
+                                           bool *already_partitioned)          \
+    {                                                                          \
+        char *i = first;                                                       \
+        char *j = last;                                                        \
+        *already_partitioned = true;                                           \
+        while (true)                                                           \
+        {                                                                      \
+            do                                                                 \
+            {                                                                  \
+                i += ES;                                                       \
+            } while (i < last && compare(i, first) < 0);                       \
+            do                                                                 \
+            {                                                                  \
+                j -= ES;                                                       \
+            } while (compare(j, first) > 0);                                   \
+            if (i >= j)                                                        \
+            {                                                                  \
+                break;                                                         \
+            }                                                                  \
+            SWAP(i, j);                                                        \
+            *already_partitioned = false;                                      \
+        }                                                                      \
+        SWAP(first, j);                                                        \
+        return j;                                                              \
+    }                                                                          \
+                                                                               \
+    static void Darray_intro_sort_##suffix(char *first, char *last, size_t es, \
+                                           DarrayCompare compare,              \
+                                           int bad_allowed)                    \
+    {                                                                          \
+        while ((size_t)(last - first) > DARRAY_SORT_INSERTION_THRESHOLD * ES)  \
+        {                                                                      \
+            size_t n = (last - first) / ES;                                    \
+            char *middle = first + n / 2 * ES;                                 \
+            if (n > 128)                                                       \
+            {                                                                  \
+                Darray_sort3_##suffix(first, middle, last - ES, es, compare);  \
+                Darray_sort3_##suffix(first + ES, middle - ES, last - 2 * ES,  \
+                                      es, compare);                            \
+                Darray_sort3_##suffix(first + 2 * ES, middle + ES,             \
+                                      last - 3 * ES, es, compare);             \
+                Darray_sort3_##suffix(middle - ES, middle, middle + ES, es,    \
+                                      compare);                                \
+            }                                                                  \
+            else                                                               \
+            {                                                                  \
+                Darray_sort3_##suffix(first, middle, last - ES, es, compare);  \
+            }                                                                  \
+            SWAP(first, middle);                                               \
+            bool already_partitioned;                                          \
+            char *pivot = Darray_partition_##suffix(first, last, es, compare,  \
+                                                    &already_partitioned);     \
+            size_t left = (pivot - first) / ES;                                \
+            size_t right = n - left - 1;                                       \
+            if (left < n / 8 || right < n / 8)                                 \
+            {                                                                  \
+                bad_allowed -= 1;                                              \
+                if (bad_allowed == 0)                                          \
+                {                                                              \
+                    Darray_heap_sort_##suffix(first, n, es, compare);          \
+                    return;                                                    \
+                }                                                              \
+                /* break up the pattern that produced the bad pivot */         \
+                if (left >= DARRAY_SORT_INSERTION_THRESHOLD)                   \
+                {                                                              \
+                    SWAP(first, first + left / 4 * ES);                        \
+                    SWAP(pivot - ES, pivot - left / 4 * ES);                   \
+                }                                                              \
+                if (right >= DARRAY_SORT_INSERTION_THRESHOLD)                  \
+                {                                                              \
+                    SWAP(pivot + ES, pivot + (1 + right / 4) * ES);            \
+                    SWAP(last - ES, last - right / 4 * ES);                    \
+                }                                                              \
+            }                                                                  \
+            else if (already_partitioned &&                                    \
+                     Darray_partial_insertion_sort_##suffix(first, pivot, es,  \
+                                                            compare) &&        \
+                     Darray_partial_insertion_sort_##suffix(pivot + ES, last,  \
+                                                            es, compare))      \
+            {                                                                  \
+                return;                                                        \
+            }                                                                  \
+            /* recurse into the smaller side, loop on the larger one */        \
+            if (left < right)                                                  \
+            {                                                                  \
+                Darray_intro_sort_##suffix(first, pivot, es, compare,          \
+                                           bad_allowed);                       \
+                first = pivot + ES;                                            \
+            }                                                                  \
+            else                                                               \
+            {                                                                  \
+                Darray_intro_sort_##suffix(pivot + ES, last, es, compare,      \
+                                           bad_allowed);                       \
+                last = pivot;                                                  \
+            }                                                                  \
+        }                                                                      \
+        Darray_insertion_sort_##suffix(first, last, es, compare);              \
+    }
+
+#define DARRAY_SWAP_FIXED(size)                                                \
+    static inline void Darray_swap_##size(char *a, char *b)                    \
+    {                                                                          \
+        char temp[size];                                                       \
+        memcpy(temp, a, size);                                                 \
+        memcpy(a, b, size);                                                    \
+        memcpy(b, temp, size);                                                 \
+    }
+
+DARRAY_SWAP_FIXED(1)
+DARRAY_SWAP_FIXED(2)
+DARRAY_SWAP_FIXED(4)
+DARRAY_SWAP_FIXED(8)
+DARRAY_SWAP_FIXED(16)
+
+static inline void Darray_swap_any(char *a, char *b, size_t es)
+{
+    char temp[64];
+    while (es > 0)
+    {
+        size_t chunk = es < sizeof temp ? es : sizeof temp;
+        memcpy(temp, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, temp, chunk);
+        a += chunk;
+        b += chunk;
+        es -= chunk;
+    }
+}
+
+#define DARRAY_SWAP_1(a, b) Darray_swap_1(a, b)
+#define DARRAY_SWAP_2(a, b) Darray_swap_2(a, b)
+#define DARRAY_SWAP_4(a, b) Darray_swap_4(a, b)
+#define DARRAY_SWAP_8(a, b) Darray_swap_8(a, b)
+#define DARRAY_SWAP_16(a, b) Darray_swap_16(a, b)
+#define DARRAY_SWAP_ANY(a, b) Darray_swap_any(a, b, es)
+
+DARRAY_SORT_FUNCTIONS(1, 1, DARRAY_SWAP_1)
+DARRAY_SORT_FUNCTIONS(2, 2, DARRAY_SWAP_2)
+DARRAY_SORT_FUNCTIONS(4, 4, DARRAY_SWAP_4)
+DARRAY_SORT_FUNCTIONS(8, 8, DARRAY_SWAP_8)
+DARRAY_SORT_FUNCTIONS(16, 16, DARRAY_SWAP_16)
+DARRAY_SORT_FUNCTIONS(any, es, DARRAY_SWAP_ANY)
+
+DARRAY_INTERNAL void Darray_sort_elements(char *first, size_t n, size_t es,
+                                          DarrayCompare compare)
+{
+    char *last = first + n * es;
+    int bad_allowed = 1;
+    for (; n > 1; n >>= 1)
+    {
+        bad_allowed += 1;
+    }
+    switch (es)
+    {
+    case 1:
+        Darray_intro_sort_1(first, last, es, compare, bad_allowed);
+        break;
+    case 2:
+        Darray_intro_sort_2(first, last, es, compare, bad_allowed);
+        break;
+    case 4:
+        Darray_intro_sort_4(first, last, es, compare, bad_allowed);
+        break;
+    case 8:
+        Darray_intro_sort_8(first, last, es, compare, bad_allowed);
+        break;
+    case 16:
+        Darray_intro_sort_16(first, last, es, compare, bad_allowed);
+        break;
+    default:
+        Darray_intro_sort_any(first, last, es, compare, bad_allowed);
+        break;
+    }
+}
+
+void Darray_sort_compare(void *data,
+                         int (*compare)(const void *, const void *))
+{
+    Darray *self = GET_SELF(data);
+    Darray_sort_elements(data, self->n_elements, self->element_size, compare);
+}
+
+void Darray_sort_range(void *data, size_t start_index, size_t end_index,
+                       int (*compare)(const void *, const void *))
+{
+    Darray *self = GET_SELF(data);
+#ifdef DARRAY_DEBUG
+    if (start_index > end_index || end_index > self->n_elements)
+    {
+        printf("Darray: refused to carry on with call to Darray_sort_range, "
+               "range overflows array length\n");
+        return;
+    }
+#endif
+    Darray_sort_elements(data + start_index * self->element_size,
+                         end_index - start_index, self->element_size, compare);
+}
+
 /* * * * CONVENIENCE * * * */
 
 void Darray_print(void *data, const char *const format,
@@ -473,4 +3008,4 @@ void Darray_print(void *data, const char *const format,
     printf("]\n");
 }
 
-#endif // #ifdef DARRAY_INCLUDE_IMPLEMENTATION
+#endif // #if defined(DARRAY_INCLUDE_IMPLEMENTATION)
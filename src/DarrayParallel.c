@@ -0,0 +1,652 @@
+#ifndef DARRAY_PARALLEL_H
+#define DARRAY_PARALLEL_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Parallel algorithms over Darrays. The contiguous buffer is split into
+ * chunks whose boundaries fall on cache line boundaries where the element
+ * size allows it, and the chunks are handed to a reusable pool of worker
+ * threads. The calling thread works on chunks too and every call returns only
+ * once all chunks are done.
+ *
+ * Every function takes the pool to run on, NULL selects a shared pool with
+ * one thread per online CPU that is created on first use. A pool runs one
+ * call at a time, calling a parallel function from inside a callback of the
+ * same pool deadlocks.
+ */
+typedef struct DarrayPool
+{
+    pthread_t *threads;
+    size_t n_threads;
+
+    pthread_mutex_t run_lock; // serializes callers
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t done;
+
+    // the current job, guarded by lock except for next_task
+    void (*task)(void *, size_t);
+    void *argument;
+    size_t n_tasks;
+    atomic_size_t next_task;
+    size_t finished;
+    size_t active; // workers that picked up the current job
+    size_t generation;
+    bool stop;
+
+    void *(*allocator)(size_t);
+    void (*liberator)(void *);
+} DarrayPool;
+
+// n_threads counts the calling thread, 0 means one per online CPU
+DarrayPool *_DarrayPool_create(size_t n_threads, void *(*allocator)(size_t),
+                               void (*liberator)(void *));
+#define DarrayPool_create(n_threads) _DarrayPool_create(n_threads, malloc, free)
+#define DarrayPool_create_allocator(n_threads, malloc, free)                   \
+    _DarrayPool_create(n_threads, malloc, free)
+void DarrayPool_destroy(DarrayPool *pool);
+
+// runs task(argument, i) for every i in [0, n_tasks) and waits for all of them
+void DarrayPool_run(DarrayPool *pool, void (*task)(void *, size_t),
+                    void *argument, size_t n_tasks);
+
+// function is called once per chunk with the chunk, its length and the index
+// of its first element
+void Darray_parallel_for(DarrayPool *pool, void *data,
+                         void (*function)(void *chunk, size_t n,
+                                          size_t start_index, void *context),
+                         void *context);
+
+// out holds the identity on entry and the result on return. reduce folds a
+// chunk into an accumulator of out_size bytes, combine folds one accumulator
+// into another. Accumulators are combined in chunk order.
+void Darray_parallel_reduce(DarrayPool *pool, void *data, void *out,
+                            size_t out_size,
+                            void (*reduce)(void *accumulator, const void *chunk,
+                                           size_t n, void *context),
+                            void (*combine)(void *accumulator,
+                                            const void *partial,
+                                            void *context),
+                            void *context);
+
+// merge sort: chunks are sorted independently, then merged pairwise with
+// every merge split across the pool. Stable only within equal keys of
+// different chunks, like Darray_sort_compare it is not stable.
+void Darray_parallel_sort(DarrayPool *pool, void *data,
+                          int (*compare)(const void *, const void *));
+
+// in place inclusive scan, combine(accumulator, element) folds an element
+// into the accumulator, which starts out as identity
+void Darray_parallel_scan(DarrayPool *pool, void *data, const void *identity,
+                          void (*combine)(void *accumulator,
+                                          const void *element));
+
+#endif // #ifndef DARRAY_PARALLEL_H
+
+#if defined(DARRAY_PARALLEL_INCLUDE_IMPLEMENTATION) &&                         \
+    !defined(DARRAY_PARALLEL_IMPLEMENTATION_INCLUDED)
+#define DARRAY_PARALLEL_IMPLEMENTATION_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#define DARRAY_PARALLEL_INTERNAL static inline
+
+#ifndef DARRAY_CACHE_LINE
+#define DARRAY_CACHE_LINE 64
+#endif
+
+// arrays shorter than this are processed on the calling thread only
+#ifndef DARRAY_PARALLEL_GRAIN
+#define DARRAY_PARALLEL_GRAIN 4096
+#endif
+
+// chunks per thread, more chunks balance uneven work at some overhead
+#define DARRAY_PARALLEL_CHUNKS_PER_THREAD 4
+
+/* * * * WORKER POOL * * * */
+
+// pops tasks until the job runs dry, returns how many it ran
+DARRAY_PARALLEL_INTERNAL size_t DarrayPool_drain(DarrayPool *pool,
+                                                 void (*task)(void *, size_t),
+                                                 void *argument,
+                                                 size_t n_tasks)
+{
+    size_t ran = 0;
+    size_t index;
+    while ((index = atomic_fetch_add(&pool->next_task, 1)) < n_tasks)
+    {
+        task(argument, index);
+        ran += 1;
+    }
+    return ran;
+}
+
+static void *DarrayPool_worker(void *arg)
+{
+    DarrayPool *pool = arg;
+    size_t seen = 0;
+    pthread_mutex_lock(&pool->lock);
+    while (true)
+    {
+        while (pool->generation == seen && !pool->stop)
+        {
+            pthread_cond_wait(&pool->wake, &pool->lock);
+        }
+        if (pool->stop)
+        {
+            break;
+        }
+        seen = pool->generation;
+        // a worker that wakes up late may find the job already finished and
+        // DarrayPool_run about to post the next one, it must not join then
+        if (pool->finished >= pool->n_tasks)
+        {
+            continue;
+        }
+        void (*task)(void *, size_t) = pool->task;
+        void *argument = pool->argument;
+        size_t n_tasks = pool->n_tasks;
+        // DarrayPool_run does not return while a worker is active, so the job
+        // and next_task stay the ones read here until it leaves
+        pool->active += 1;
+        pthread_mutex_unlock(&pool->lock);
+
+        size_t ran = DarrayPool_drain(pool, task, argument, n_tasks);
+
+        pthread_mutex_lock(&pool->lock);
+        pool->finished += ran;
+        pool->active -= 1;
+        if (pool->finished >= pool->n_tasks && pool->active == 0)
+        {
+            pthread_cond_signal(&pool->done);
+        }
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+DarrayPool *_DarrayPool_create(size_t n_threads, void *(*allocator)(size_t),
+                               void (*liberator)(void *))
+{
+    if (n_threads == 0)
+    {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = online > 0 ? (size_t)online : 1;
+    }
+    DarrayPool *pool = allocator(sizeof(DarrayPool));
+    memset(pool, 0, sizeof(DarrayPool));
+    pool->allocator = allocator;
+    pool->liberator = liberator;
+    pthread_mutex_init(&pool->run_lock, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->wake, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    atomic_init(&pool->next_task, 0);
+
+    // the caller is the first thread
+    pool->threads = allocator((n_threads - 1) * sizeof(pthread_t) + 1);
+    for (size_t i = 0; i < n_threads - 1; i++)
+    {
+        if (pthread_create(&pool->threads[i], NULL, DarrayPool_worker, pool) !=
+            0)
+        {
+            break;
+        }
+        pool->n_threads += 1;
+    }
+    return pool;
+}
+
+void DarrayPool_destroy(DarrayPool *pool)
+{
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+    for (size_t i = 0; i < pool->n_threads; i++)
+    {
+        pthread_join(pool->threads[i], NULL);
+    }
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->wake);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->run_lock);
+    pool->liberator(pool->threads);
+    pool->liberator(pool);
+}
+
+static DarrayPool *DarrayPool_shared = NULL;
+static pthread_once_t DarrayPool_shared_once = PTHREAD_ONCE_INIT;
+
+static void DarrayPool_create_shared(void)
+{
+    DarrayPool_shared = DarrayPool_create(0);
+}
+
+DARRAY_PARALLEL_INTERNAL DarrayPool *DarrayPool_get(DarrayPool *pool)
+{
+    if (pool != NULL)
+    {
+        return pool;
+    }
+    pthread_once(&DarrayPool_shared_once, DarrayPool_create_shared);
+    return DarrayPool_shared;
+}
+
+void DarrayPool_run(DarrayPool *pool, void (*task)(void *, size_t),
+                    void *argument, size_t n_tasks)
+{
+    pool = DarrayPool_get(pool);
+    if (pool->n_threads == 0 || n_tasks < 2)
+    {
+        for (size_t i = 0; i < n_tasks; i++)
+        {
+            task(argument, i);
+        }
+        return;
+    }
+    pthread_mutex_lock(&pool->run_lock);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->task = task;
+    pool->argument = argument;
+    pool->n_tasks = n_tasks;
+    pool->finished = 0;
+    atomic_store(&pool->next_task, 0);
+    pool->generation += 1;
+    pthread_cond_broadcast(&pool->wake);
+    pthread_mutex_unlock(&pool->lock);
+
+    size_t ran = DarrayPool_drain(pool, task, argument, n_tasks);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->finished += ran;
+    while (pool->finished < n_tasks || pool->active > 0)
+    {
+        pthread_cond_wait(&pool->done, &pool->lock);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->run_lock);
+}
+
+/* * * *   CHUNKING   * * * */
+/* * * * (Internal) * * * */
+
+typedef struct DarrayChunks
+{
+    char *data;
+    size_t element_size;
+    size_t n_elements;
+    size_t n_chunks;
+    size_t step;  // elements per chunk
+    size_t first; // elements before the first cache line boundary
+} DarrayChunks;
+
+DARRAY_PARALLEL_INTERNAL size_t Darray_gcd(size_t a, size_t b)
+{
+    while (b != 0)
+    {
+        size_t r = a % b;
+        a = b;
+        b = r;
+    }
+    return a;
+}
+
+// chunk lengths are whole cache lines and the first chunk absorbs the
+// misalignment of the buffer, so no two chunks write to the same line
+DARRAY_PARALLEL_INTERNAL DarrayChunks Darray_chunks(DarrayPool *pool,
+                                                    void *data)
+{
+    Darray *self = GET_SELF(data);
+    DarrayChunks chunks = {
+        .data = data,
+        .element_size = self->element_size,
+        .n_elements = self->n_elements,
+        .n_chunks = 1,
+        .step = self->n_elements,
+        .first = 0,
+    };
+    size_t n_threads = pool->n_threads + 1;
+    if (self->n_elements < DARRAY_PARALLEL_GRAIN || n_threads == 1)
+    {
+        return chunks;
+    }
+    size_t es = self->element_size;
+    size_t quantum = DARRAY_CACHE_LINE / Darray_gcd(es, DARRAY_CACHE_LINE);
+    size_t misalignment = -(uintptr_t)data % DARRAY_CACHE_LINE;
+    if (misalignment % es == 0)
+    {
+        chunks.first = misalignment / es;
+    }
+    size_t wanted = n_threads * DARRAY_PARALLEL_CHUNKS_PER_THREAD;
+    size_t step = (self->n_elements + wanted - 1) / wanted;
+    if (step < DARRAY_PARALLEL_GRAIN / DARRAY_PARALLEL_CHUNKS_PER_THREAD)
+    {
+        step = DARRAY_PARALLEL_GRAIN / DARRAY_PARALLEL_CHUNKS_PER_THREAD;
+    }
+    chunks.step = (step + quantum - 1) / quantum * quantum;
+    chunks.n_chunks =
+        (self->n_elements - chunks.first + chunks.step - 1) / chunks.step;
+    return chunks;
+}
+
+DARRAY_PARALLEL_INTERNAL size_t Darray_chunk_start(DarrayChunks *chunks,
+                                                   size_t index)
+{
+    if (index == 0)
+    {
+        return 0;
+    }
+    size_t start = chunks->first + index * chunks->step;
+    return start < chunks->n_elements ? start : chunks->n_elements;
+}
+
+/* * * * PARALLEL FOR * * * */
+
+typedef struct DarrayForJob
+{
+    DarrayChunks chunks;
+    void (*function)(void *, size_t, size_t, void *);
+    void *context;
+} DarrayForJob;
+
+static void Darray_parallel_for_task(void *arg, size_t index)
+{
+    DarrayForJob *job = arg;
+    size_t start = Darray_chunk_start(&job->chunks, index);
+    size_t end = Darray_chunk_start(&job->chunks, index + 1);
+    job->function(job->chunks.data + start * job->chunks.element_size,
+                  end - start, start, job->context);
+}
+
+void Darray_parallel_for(DarrayPool *pool, void *data,
+                         void (*function)(void *chunk, size_t n,
+                                          size_t start_index, void *context),
+                         void *context)
+{
+    pool = DarrayPool_get(pool);
+    DarrayForJob job = {
+        .chunks = Darray_chunks(pool, data),
+        .function = function,
+        .context = context,
+    };
+    DarrayPool_run(pool, Darray_parallel_for_task, &job, job.chunks.n_chunks);
+}
+
+/* * * * PARALLEL REDUCE * * * */
+
+typedef struct DarrayReduceJob
+{
+    DarrayChunks chunks;
+    char *partials;
+    size_t partial_size; // out_size rounded up to a cache line
+    void (*reduce)(void *, const void *, size_t, void *);
+    void *context;
+} DarrayReduceJob;
+
+static void Darray_parallel_reduce_task(void *arg, size_t index)
+{
+    DarrayReduceJob *job = arg;
+    size_t start = Darray_chunk_start(&job->chunks, index);
+    size_t end = Darray_chunk_start(&job->chunks, index + 1);
+    job->reduce(job->partials + index * job->partial_size,
+                job->chunks.data + start * job->chunks.element_size,
+                end - start, job->context);
+}
+
+void Darray_parallel_reduce(DarrayPool *pool, void *data, void *out,
+                            size_t out_size,
+                            void (*reduce)(void *accumulator, const void *chunk,
+                                           size_t n, void *context),
+                            void (*combine)(void *accumulator,
+                                            const void *partial,
+                                            void *context),
+                            void *context)
+{
+    pool = DarrayPool_get(pool);
+    DarrayReduceJob job = {
+        .chunks = Darray_chunks(pool, data),
+        .partial_size = (out_size + DARRAY_CACHE_LINE - 1) /
+                        DARRAY_CACHE_LINE * DARRAY_CACHE_LINE,
+        .reduce = reduce,
+        .context = context,
+    };
+    if (job.chunks.n_chunks == 1)
+    {
+        reduce(out, data, job.chunks.n_elements, context);
+        return;
+    }
+    job.partials = pool->allocator(job.chunks.n_chunks * job.partial_size);
+    for (size_t i = 0; i < job.chunks.n_chunks; i++)
+    {
+        memcpy(job.partials + i * job.partial_size, out, out_size);
+    }
+    DarrayPool_run(pool, Darray_parallel_reduce_task, &job,
+                   job.chunks.n_chunks);
+    for (size_t i = 0; i < job.chunks.n_chunks; i++)
+    {
+        combine(out, job.partials + i * job.partial_size, context);
+    }
+    pool->liberator(job.partials);
+}
+
+/* * * * PARALLEL SORT * * * */
+
+typedef struct DarraySortJob
+{
+    DarrayChunks chunks;
+    int (*compare)(const void *, const void *);
+
+    // merge pass: runs of width elements are merged pairwise from source to
+    // destination, every pair split into pieces output ranges
+    char *source;
+    char *destination;
+    size_t width;
+    size_t pieces;
+} DarraySortJob;
+
+static void Darray_parallel_sort_task(void *arg, size_t index)
+{
+    DarraySortJob *job = arg;
+    size_t start = Darray_chunk_start(&job->chunks, index);
+    size_t end = Darray_chunk_start(&job->chunks, index + 1);
+    Darray_sort_range(job->chunks.data, start, end, job->compare);
+}
+
+// number of elements of a that come first among the first k merged elements
+DARRAY_PARALLEL_INTERNAL size_t Darray_merge_split(char *a, size_t m, char *b,
+                                                   size_t n, size_t k,
+                                                   size_t es,
+                                                   int (*compare)(const void *,
+                                                                  const void *))
+{
+    size_t low = k > n ? k - n : 0;
+    size_t high = k < m ? k : m;
+    while (low < high)
+    {
+        size_t i = low + (high - low) / 2;
+        if (compare(a + i * es, b + (k - i - 1) * es) <= 0)
+        {
+            low = i + 1;
+        }
+        else
+        {
+            high = i;
+        }
+    }
+    return low;
+}
+
+static void Darray_parallel_merge_task(void *arg, size_t index)
+{
+    DarraySortJob *job = arg;
+    size_t es = job->chunks.element_size;
+    size_t pair = index / job->pieces;
+    size_t piece = index % job->pieces;
+
+    // runs are made of width chunks, the last pair may be short or lone
+    size_t first_chunk = pair * 2 * job->width;
+    size_t low = Darray_chunk_start(&job->chunks, first_chunk);
+    size_t middle = Darray_chunk_start(&job->chunks, first_chunk + job->width);
+    size_t high =
+        Darray_chunk_start(&job->chunks, first_chunk + 2 * job->width);
+    char *a = job->source + low * es;
+    char *b = job->source + middle * es;
+    size_t m = middle - low;
+    size_t n = high - middle;
+
+    size_t k0 = (m + n) * piece / job->pieces;
+    size_t k1 = (m + n) * (piece + 1) / job->pieces;
+    size_t i = Darray_merge_split(a, m, b, n, k0, es, job->compare);
+    size_t j = k0 - i;
+    size_t i_end = Darray_merge_split(a, m, b, n, k1, es, job->compare);
+    size_t j_end = k1 - i_end;
+    char *out = job->destination + (low + k0) * es;
+    while (i < i_end && j < j_end)
+    {
+        if (job->compare(b + j * es, a + i * es) < 0)
+        {
+            memcpy(out, b + j * es, es);
+            j += 1;
+        }
+        else
+        {
+            memcpy(out, a + i * es, es);
+            i += 1;
+        }
+        out += es;
+    }
+    memcpy(out, a + i * es, (i_end - i) * es);
+    out += (i_end - i) * es;
+    memcpy(out, b + j * es, (j_end - j) * es);
+}
+
+void Darray_parallel_sort(DarrayPool *pool, void *data,
+                          int (*compare)(const void *, const void *))
+{
+    pool = DarrayPool_get(pool);
+    DarraySortJob job = {
+        .chunks = Darray_chunks(pool, data),
+        .compare = compare,
+    };
+    size_t n_chunks = job.chunks.n_chunks;
+    DarrayPool_run(pool, Darray_parallel_sort_task, &job, n_chunks);
+    if (n_chunks == 1)
+    {
+        return;
+    }
+
+    size_t size = job.chunks.n_elements * job.chunks.element_size;
+    char *buffer = pool->allocator(size);
+    job.source = data;
+    job.destination = buffer;
+    for (job.width = 1; job.width < n_chunks; job.width *= 2)
+    {
+        size_t pairs = (n_chunks + 2 * job.width - 1) / (2 * job.width);
+        size_t wanted = n_chunks / pairs;
+        job.pieces = wanted > 0 ? wanted : 1;
+        DarrayPool_run(pool, Darray_parallel_merge_task, &job,
+                       pairs * job.pieces);
+        char *swap = job.source;
+        job.source = job.destination;
+        job.destination = swap;
+    }
+    if (job.source != data)
+    {
+        memcpy(data, job.source, size);
+    }
+    pool->liberator(buffer);
+}
+
+/* * * * PARALLEL SCAN * * * */
+
+typedef struct DarrayScanJob
+{
+    DarrayChunks chunks;
+    const void *identity;
+    void (*combine)(void *, const void *);
+    char *totals; // one accumulator per chunk, one cache line apart
+    size_t total_size;
+} DarrayScanJob;
+
+// first pass, every chunk computes its total
+static void Darray_parallel_scan_total_task(void *arg, size_t index)
+{
+    DarrayScanJob *job = arg;
+    size_t es = job->chunks.element_size;
+    size_t start = Darray_chunk_start(&job->chunks, index);
+    size_t end = Darray_chunk_start(&job->chunks, index + 1);
+    char *total = job->totals + index * job->total_size;
+    memcpy(total, job->identity, es);
+    for (size_t i = start; i < end; i++)
+    {
+        job->combine(total, job->chunks.data + i * es);
+    }
+}
+
+// second pass, every chunk scans itself starting from the totals before it
+static void Darray_parallel_scan_task(void *arg, size_t index)
+{
+    DarrayScanJob *job = arg;
+    size_t es = job->chunks.element_size;
+    size_t start = Darray_chunk_start(&job->chunks, index);
+    size_t end = Darray_chunk_start(&job->chunks, index + 1);
+    char *carry = job->totals + index * job->total_size;
+    for (size_t i = start; i < end; i++)
+    {
+        char *element = job->chunks.data + i * es;
+        job->combine(carry, element);
+        memcpy(element, carry, es);
+    }
+}
+
+void Darray_parallel_scan(DarrayPool *pool, void *data, const void *identity,
+                          void (*combine)(void *accumulator,
+                                          const void *element))
+{
+    pool = DarrayPool_get(pool);
+    DarrayScanJob job = {
+        .chunks = Darray_chunks(pool, data),
+        .identity = identity,
+        .combine = combine,
+    };
+    size_t es = job.chunks.element_size;
+    size_t n_chunks = job.chunks.n_chunks;
+    job.total_size =
+        (es + DARRAY_CACHE_LINE - 1) / DARRAY_CACHE_LINE * DARRAY_CACHE_LINE;
+    // two spare slots after the chunk totals hold the running carry
+    job.totals = pool->allocator((n_chunks + 2) * job.total_size);
+    char *carry = job.totals + n_chunks * job.total_size;
+    char *total = carry + job.total_size;
+    memcpy(carry, identity, es);
+    if (n_chunks > 1)
+    {
+        DarrayPool_run(pool, Darray_parallel_scan_total_task, &job, n_chunks);
+    }
+
+    // exclusive scan of the chunk totals turns them into carries, the total
+    // of the last chunk is never computed since nothing comes after it
+    for (size_t i = 0; i + 1 < n_chunks; i++)
+    {
+        char *slot = job.totals + i * job.total_size;
+        memcpy(total, slot, es);
+        memcpy(slot, carry, es);
+        combine(carry, total);
+    }
+    memcpy(job.totals + (n_chunks - 1) * job.total_size, carry, es);
+    DarrayPool_run(pool, Darray_parallel_scan_task, &job, n_chunks);
+    pool->liberator(job.totals);
+}
+
+#endif // #if defined(DARRAY_PARALLEL_INCLUDE_IMPLEMENTATION)
@@ -0,0 +1,282 @@
+#ifndef GAP_BUFFER_H
+#define GAP_BUFFER_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Gap buffer: a contiguous array whose free space is kept at the cursor
+ * position. Inserting or deleting at the cursor is O(1), moving the cursor
+ * costs O(distance).
+ *
+ *   [ elements before cursor ][   gap   ][ elements after cursor ]
+ *   ^ data                    ^ gap_start ^ gap_end               ^ capacity
+ */
+typedef struct GapBuffer
+{
+    void *data;
+    size_t element_size;
+    size_t capacity;
+    size_t gap_start;
+    size_t gap_end;
+
+    void *(*allocator)(size_t);
+    void *(*reallocator)(void *, size_t);
+    void (*liberator)(void *);
+} GapBuffer;
+
+GapBuffer _GapBuffer_create(size_t element_size, size_t capacity,
+                            void *(*allocator)(size_t),
+                            void *(*reallocator)(void *, size_t),
+                            void (*liberator)(void *));
+#define GapBuffer_create(type, capacity)                                       \
+    _GapBuffer_create(sizeof(type), capacity, malloc, realloc, free)
+#define GapBuffer_create_allocator(type, capacity, malloc, realloc, free)      \
+    _GapBuffer_create(sizeof(type), capacity, malloc, realloc, free)
+
+void GapBuffer_destroy(GapBuffer *self);
+
+size_t GapBuffer_length(GapBuffer *self);
+size_t GapBuffer_get_cursor(GapBuffer *self);
+void *GapBuffer_get(GapBuffer *self, size_t index);
+
+void GapBuffer_move_cursor(GapBuffer *self, size_t index);
+
+void _GapBuffer_push(GapBuffer *self, void *element);
+#define GapBuffer_push(self, element)                                          \
+    {                                                                          \
+        __auto_type GapBuffer_push_temp_var = element;                         \
+        _GapBuffer_push(self, &GapBuffer_push_temp_var);                       \
+    }
+
+void GapBuffer_push_multiple(GapBuffer *self, void *array, size_t n);
+
+void _GapBuffer_push_at(GapBuffer *self, size_t index, void *element);
+#define GapBuffer_push_at(self, index, element)                                \
+    {                                                                          \
+        __auto_type GapBuffer_push_temp_var = element;                         \
+        _GapBuffer_push_at(self, index, &GapBuffer_push_temp_var);             \
+    }
+
+void GapBuffer_pop(GapBuffer *self, void *out);
+void GapBuffer_pop_multiple(GapBuffer *self, void *out, size_t n);
+void GapBuffer_pop_forward(GapBuffer *self, void *out);
+void GapBuffer_pop_forward_multiple(GapBuffer *self, void *out, size_t n);
+void GapBuffer_pop_at(GapBuffer *self, size_t index, void *out);
+
+void *GapBuffer_to_Darray(GapBuffer *self);
+
+#endif // #ifndef GAP_BUFFER_H
+
+#if defined(GAP_BUFFER_INCLUDE_IMPLEMENTATION) &&                              \
+    !defined(GAP_BUFFER_IMPLEMENTATION_INCLUDED)
+#define GAP_BUFFER_IMPLEMENTATION_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+
+#define GAP_BUFFER_INTERNAL static inline
+
+#define GAP_BUFFER_AT(self, index)                                             \
+    ((self)->data + (index) * (self)->element_size)
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+GapBuffer _GapBuffer_create(size_t element_size, size_t capacity,
+                            void *(*allocator)(size_t),
+                            void *(*reallocator)(void *, size_t),
+                            void (*liberator)(void *))
+{
+    GapBuffer result = {
+        .data = allocator(capacity * element_size),
+        .element_size = element_size,
+        .capacity = capacity,
+        .gap_start = 0,
+        .gap_end = capacity,
+        .allocator = allocator,
+        .reallocator = reallocator,
+        .liberator = liberator,
+    };
+    return result;
+}
+
+void GapBuffer_destroy(GapBuffer *self)
+{
+    self->liberator(self->data);
+    memset(self, 0, sizeof(GapBuffer));
+}
+
+/* * * * GETTERS * * * */
+
+size_t GapBuffer_length(GapBuffer *self)
+{
+    return self->capacity - (self->gap_end - self->gap_start);
+}
+
+size_t GapBuffer_get_cursor(GapBuffer *self)
+{
+    return self->gap_start;
+}
+
+void *GapBuffer_get(GapBuffer *self, size_t index)
+{
+    if (index < self->gap_start)
+    {
+        return GAP_BUFFER_AT(self, index);
+    }
+    return GAP_BUFFER_AT(self, index + self->gap_end - self->gap_start);
+}
+
+/* * * *  RESIZING  * * * */
+/* * * * (Internal) * * * */
+
+GAP_BUFFER_INTERNAL void GapBuffer_check_full_and_resize(GapBuffer *self,
+                                                         size_t n)
+{
+    if (self->gap_end - self->gap_start >= n)
+    {
+        return;
+    }
+    size_t length = GapBuffer_length(self);
+    size_t new_capacity = self->capacity == 0 ? 1 : self->capacity;
+    while (new_capacity - length < n)
+    {
+        new_capacity *= 2;
+    }
+    size_t tail_size = self->capacity - self->gap_end;
+    self->data =
+        self->reallocator(self->data, new_capacity * self->element_size);
+    memmove(GAP_BUFFER_AT(self, new_capacity - tail_size),
+            GAP_BUFFER_AT(self, self->gap_end), tail_size * self->element_size);
+    self->gap_end = new_capacity - tail_size;
+    self->capacity = new_capacity;
+}
+
+/* * * * CURSOR * * * */
+
+// only the elements between the old and the new cursor are moved
+void GapBuffer_move_cursor(GapBuffer *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index > GapBuffer_length(self))
+    {
+        printf("GapBuffer: refused to carry on with call to "
+               "GapBuffer_move_cursor, index overflows buffer length\n");
+        return;
+    }
+#endif
+    if (index < self->gap_start)
+    {
+        size_t n = self->gap_start - index;
+        memmove(GAP_BUFFER_AT(self, self->gap_end - n),
+                GAP_BUFFER_AT(self, index), n * self->element_size);
+        self->gap_start -= n;
+        self->gap_end -= n;
+    }
+    else if (index > self->gap_start)
+    {
+        size_t n = index - self->gap_start;
+        memmove(GAP_BUFFER_AT(self, self->gap_start),
+                GAP_BUFFER_AT(self, self->gap_end), n * self->element_size);
+        self->gap_start += n;
+        self->gap_end += n;
+    }
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+// inserts before the cursor, the cursor ends up after the inserted element
+void _GapBuffer_push(GapBuffer *self, void *element)
+{
+    GapBuffer_push_multiple(self, element, 1);
+}
+
+void GapBuffer_push_multiple(GapBuffer *self, void *array, size_t n)
+{
+    GapBuffer_check_full_and_resize(self, n);
+    memcpy(GAP_BUFFER_AT(self, self->gap_start), array,
+           n * self->element_size);
+    self->gap_start += n;
+}
+
+void _GapBuffer_push_at(GapBuffer *self, size_t index, void *element)
+{
+    GapBuffer_move_cursor(self, index);
+    GapBuffer_push_multiple(self, element, 1);
+}
+
+// removes the element before the cursor (backspace)
+void GapBuffer_pop(GapBuffer *self, void *out)
+{
+    GapBuffer_pop_multiple(self, out, 1);
+}
+
+void GapBuffer_pop_multiple(GapBuffer *self, void *out, size_t n)
+{
+#ifdef DARRAY_DEBUG
+    if (self->gap_start < n)
+    {
+        printf("GapBuffer: refused to carry on with call to "
+               "GapBuffer_pop_multiple, not enough elements before the "
+               "cursor\n");
+        return;
+    }
+#endif
+    self->gap_start -= n;
+    if (out != NULL)
+    {
+        memcpy(out, GAP_BUFFER_AT(self, self->gap_start),
+               n * self->element_size);
+    }
+}
+
+// removes the element after the cursor (delete)
+void GapBuffer_pop_forward(GapBuffer *self, void *out)
+{
+    GapBuffer_pop_forward_multiple(self, out, 1);
+}
+
+void GapBuffer_pop_forward_multiple(GapBuffer *self, void *out, size_t n)
+{
+#ifdef DARRAY_DEBUG
+    if (self->capacity - self->gap_end < n)
+    {
+        printf("GapBuffer: refused to carry on with call to "
+               "GapBuffer_pop_forward_multiple, not enough elements after the "
+               "cursor\n");
+        return;
+    }
+#endif
+    if (out != NULL)
+    {
+        memcpy(out, GAP_BUFFER_AT(self, self->gap_end),
+               n * self->element_size);
+    }
+    self->gap_end += n;
+}
+
+void GapBuffer_pop_at(GapBuffer *self, size_t index, void *out)
+{
+    GapBuffer_move_cursor(self, index);
+    GapBuffer_pop_forward_multiple(self, out, 1);
+}
+
+/* * * * CONVERSION * * * */
+
+// allocates a new Darray with the contents in logical order, the gap buffer
+// is left untouched
+void *GapBuffer_to_Darray(GapBuffer *self)
+{
+    size_t length = GapBuffer_length(self);
+    void *result =
+        _Darray_create(self->element_size, length + 1, self->allocator,
+                       self->reallocator, self->liberator);
+    _Darray_push_multiple(&result, self->data, self->gap_start);
+    _Darray_push_multiple(&result, GAP_BUFFER_AT(self, self->gap_end),
+                          self->capacity - self->gap_end);
+    return result;
+}
+
+#endif // #if defined(GAP_BUFFER_INCLUDE_IMPLEMENTATION)
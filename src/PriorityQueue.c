@@ -0,0 +1,348 @@
+#ifndef PRIORITY_QUEUE_H
+#define PRIORITY_QUEUE_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Priority queue: an implicit d-ary heap stored in a Darray, the element that
+ * compares lowest is on top. Push, pop and decrease_key are O(log n), building
+ * a queue from an existing Darray is O(n).
+ *
+ *   children of position i: (i << arity_shift) + 1 ... + arity
+ *
+ * A 4-ary heap is half as deep as a binary one and its children are adjacent,
+ * so a pop touches fewer cache lines for a few more comparisons per level.
+ *
+ * Every pushed element gets a handle that stays valid until the element is
+ * popped, handles of popped elements are reused. Elements move with the hole
+ * technique, one copy per level instead of a swap.
+ */
+#define PRIORITY_QUEUE_NONE SIZE_MAX
+
+typedef struct PriorityQueue
+{
+    void *data;           // Darray of elements in heap order
+    size_t *handles;      // Darray, handle of the element at each position
+    size_t *positions;    // Darray, position of each handle or NONE
+    size_t *free_handles; // Darray of handles that can be reused
+    size_t element_size;
+    size_t arity_shift;
+    int (*compare)(const void *, const void *);
+    void *scratch; // holds the element being sifted
+
+    void *(*allocator)(size_t);
+    void *(*reallocator)(void *, size_t);
+    void (*liberator)(void *);
+} PriorityQueue;
+
+// arity is rounded up to a power of two, 2 and 4 are the useful ones
+PriorityQueue _PriorityQueue_create(size_t element_size, size_t capacity,
+                                    size_t arity,
+                                    int (*compare)(const void *, const void *),
+                                    void *(*allocator)(size_t),
+                                    void *(*reallocator)(void *, size_t),
+                                    void (*liberator)(void *));
+#define PriorityQueue_create(type, capacity, arity, compare)                   \
+    _PriorityQueue_create(sizeof(type), capacity, arity, compare, malloc,      \
+                          realloc, free)
+#define PriorityQueue_create_allocator(type, capacity, arity, compare, malloc, \
+                                       realloc, free)                          \
+    _PriorityQueue_create(sizeof(type), capacity, arity, compare, malloc,      \
+                          realloc, free)
+
+// heapifies the elements of data in place and takes ownership of it, the
+// handle of every element is its index in data
+PriorityQueue _PriorityQueue_from_Darray(
+    void *data, size_t arity, int (*compare)(const void *, const void *),
+    void *(*allocator)(size_t), void *(*reallocator)(void *, size_t),
+    void (*liberator)(void *));
+#define PriorityQueue_from_Darray(data, arity, compare)                        \
+    _PriorityQueue_from_Darray(data, arity, compare, malloc, realloc, free)
+
+void PriorityQueue_destroy(PriorityQueue *self);
+
+size_t PriorityQueue_length(PriorityQueue *self);
+// the lowest element, NULL when the queue is empty
+void *PriorityQueue_top(PriorityQueue *self);
+void *PriorityQueue_get(PriorityQueue *self, size_t handle);
+
+// returns the handle of the pushed element
+size_t _PriorityQueue_push(PriorityQueue *self, void *element);
+#define PriorityQueue_push(self, element)                                      \
+    {                                                                          \
+        __auto_type PriorityQueue_push_temp_var = element;                     \
+        _PriorityQueue_push(self, &PriorityQueue_push_temp_var);               \
+    }
+
+void PriorityQueue_pop(PriorityQueue *self, void *out);
+
+// replaces the element of handle with one that compares lower or equal
+void PriorityQueue_decrease_key(PriorityQueue *self, size_t handle,
+                                void *element);
+
+#endif // #ifndef PRIORITY_QUEUE_H
+
+#if defined(PRIORITY_QUEUE_INCLUDE_IMPLEMENTATION) &&                          \
+    !defined(PRIORITY_QUEUE_IMPLEMENTATION_INCLUDED)
+#define PRIORITY_QUEUE_IMPLEMENTATION_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+
+#define PRIORITY_QUEUE_INTERNAL static inline
+
+#define PRIORITY_QUEUE_AT(self, position)                                      \
+    ((self)->data + (position) * (self)->element_size)
+
+/* * * *  HEAP ORDER  * * * */
+/* * * * (Internal) * * * */
+
+PRIORITY_QUEUE_INTERNAL void PriorityQueue_place(PriorityQueue *self,
+                                                 size_t position,
+                                                 const void *element,
+                                                 size_t handle)
+{
+    memcpy(PRIORITY_QUEUE_AT(self, position), element, self->element_size);
+    self->handles[position] = handle;
+    self->positions[handle] = position;
+}
+
+// moves the hole at position up until the scratch element fits in it
+PRIORITY_QUEUE_INTERNAL void PriorityQueue_sift_up(PriorityQueue *self,
+                                                   size_t position,
+                                                   size_t handle)
+{
+    while (position > 0)
+    {
+        size_t parent = (position - 1) >> self->arity_shift;
+        if (self->compare(self->scratch, PRIORITY_QUEUE_AT(self, parent)) >= 0)
+        {
+            break;
+        }
+        PriorityQueue_place(self, position, PRIORITY_QUEUE_AT(self, parent),
+                            self->handles[parent]);
+        position = parent;
+    }
+    PriorityQueue_place(self, position, self->scratch, handle);
+}
+
+// moves the hole at position down until the scratch element fits in it
+PRIORITY_QUEUE_INTERNAL void PriorityQueue_sift_down(PriorityQueue *self,
+                                                     size_t position,
+                                                     size_t handle)
+{
+    size_t n = Darray_length(self->data);
+    size_t arity = (size_t)1 << self->arity_shift;
+    while (true)
+    {
+        size_t first = (position << self->arity_shift) + 1;
+        if (first >= n)
+        {
+            break;
+        }
+        size_t last = n - first < arity ? n : first + arity;
+        size_t best = first;
+        for (size_t child = first + 1; child < last; child++)
+        {
+            if (self->compare(PRIORITY_QUEUE_AT(self, child),
+                              PRIORITY_QUEUE_AT(self, best)) < 0)
+            {
+                best = child;
+            }
+        }
+        // the children of best are compared next
+        __builtin_prefetch(
+            PRIORITY_QUEUE_AT(self, (best << self->arity_shift) + 1));
+        if (self->compare(PRIORITY_QUEUE_AT(self, best), self->scratch) >= 0)
+        {
+            break;
+        }
+        PriorityQueue_place(self, position, PRIORITY_QUEUE_AT(self, best),
+                            self->handles[best]);
+        position = best;
+    }
+    PriorityQueue_place(self, position, self->scratch, handle);
+}
+
+PRIORITY_QUEUE_INTERNAL size_t PriorityQueue_arity_shift(size_t arity)
+{
+    size_t shift = 1;
+    while (((size_t)1 << shift) < arity)
+    {
+        shift += 1;
+    }
+    return shift;
+}
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+PriorityQueue _PriorityQueue_create(size_t element_size, size_t capacity,
+                                    size_t arity,
+                                    int (*compare)(const void *, const void *),
+                                    void *(*allocator)(size_t),
+                                    void *(*reallocator)(void *, size_t),
+                                    void (*liberator)(void *))
+{
+    PriorityQueue result = {
+        .data = _Darray_create(element_size, capacity, allocator, reallocator,
+                               liberator),
+        .handles = _Darray_create(sizeof(size_t), capacity, allocator,
+                                  reallocator, liberator),
+        .positions = _Darray_create(sizeof(size_t), capacity, allocator,
+                                    reallocator, liberator),
+        .free_handles = _Darray_create(sizeof(size_t), 1, allocator,
+                                       reallocator, liberator),
+        .element_size = element_size,
+        .arity_shift = PriorityQueue_arity_shift(arity),
+        .compare = compare,
+        .scratch = allocator(element_size),
+        .allocator = allocator,
+        .reallocator = reallocator,
+        .liberator = liberator,
+    };
+    return result;
+}
+
+// Floyd's construction: sifting down every parent from the last one is O(n)
+PriorityQueue _PriorityQueue_from_Darray(
+    void *data, size_t arity, int (*compare)(const void *, const void *),
+    void *(*allocator)(size_t), void *(*reallocator)(void *, size_t),
+    void (*liberator)(void *))
+{
+    size_t n = Darray_length(data);
+    size_t element_size = (GET_SELF(data))->element_size;
+    PriorityQueue result = _PriorityQueue_create(
+        element_size, 1, arity, compare, allocator, reallocator, liberator);
+    Darray_destroy(result.data);
+    result.data = data;
+    _Darray_make_room((void **)&result.handles, n);
+    _Darray_make_room((void **)&result.positions, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        Darray_push(&result.handles, i);
+        Darray_push(&result.positions, i);
+    }
+    for (size_t i = n > 1 ? ((n - 2) >> result.arity_shift) + 1 : 0; i > 0;
+         i--)
+    {
+        memcpy(result.scratch, PRIORITY_QUEUE_AT(&result, i - 1),
+               element_size);
+        PriorityQueue_sift_down(&result, i - 1, result.handles[i - 1]);
+    }
+    return result;
+}
+
+void PriorityQueue_destroy(PriorityQueue *self)
+{
+    Darray_destroy(self->data);
+    Darray_destroy(self->handles);
+    Darray_destroy(self->positions);
+    Darray_destroy(self->free_handles);
+    self->liberator(self->scratch);
+    memset(self, 0, sizeof(PriorityQueue));
+}
+
+/* * * * GETTERS * * * */
+
+size_t PriorityQueue_length(PriorityQueue *self)
+{
+    return Darray_length(self->data);
+}
+
+void *PriorityQueue_top(PriorityQueue *self)
+{
+    return Darray_length(self->data) ? self->data : NULL;
+}
+
+void *PriorityQueue_get(PriorityQueue *self, size_t handle)
+{
+#ifdef DARRAY_DEBUG
+    if (handle >= Darray_length(self->positions) ||
+        self->positions[handle] == PRIORITY_QUEUE_NONE)
+    {
+        printf("PriorityQueue: refused to carry on with call to "
+               "PriorityQueue_get, handle is not in the queue\n");
+        return NULL;
+    }
+#endif
+    return PRIORITY_QUEUE_AT(self, self->positions[handle]);
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+size_t _PriorityQueue_push(PriorityQueue *self, void *element)
+{
+    size_t handle;
+    if (Darray_length(self->free_handles) > 0)
+    {
+        Darray_pop(&self->free_handles, &handle);
+    }
+    else
+    {
+        handle = Darray_length(self->positions);
+        Darray_push(&self->positions, (size_t)PRIORITY_QUEUE_NONE);
+    }
+    size_t position = Darray_length(self->data);
+    memcpy(self->scratch, element, self->element_size);
+    // opens the hole at the end, sift_up fills it
+    _Darray_push(&self->data, element);
+    Darray_push(&self->handles, handle);
+    PriorityQueue_sift_up(self, position, handle);
+    return handle;
+}
+
+// the last element fills the hole left by the top
+void PriorityQueue_pop(PriorityQueue *self, void *out)
+{
+#ifdef DARRAY_DEBUG
+    if (Darray_length(self->data) == 0)
+    {
+        printf("PriorityQueue: refused to carry on with call to "
+               "PriorityQueue_pop, queue is empty\n");
+        return;
+    }
+#endif
+    if (out != NULL)
+    {
+        memcpy(out, self->data, self->element_size);
+    }
+    size_t top_handle = self->handles[0];
+    self->positions[top_handle] = PRIORITY_QUEUE_NONE;
+    Darray_push(&self->free_handles, top_handle);
+
+    size_t last_handle;
+    _Darray_pop(&self->data, self->scratch);
+    Darray_pop(&self->handles, &last_handle);
+    if (Darray_length(self->data) > 0)
+    {
+        PriorityQueue_sift_down(self, 0, last_handle);
+    }
+}
+
+void PriorityQueue_decrease_key(PriorityQueue *self, size_t handle,
+                                void *element)
+{
+#ifdef DARRAY_DEBUG
+    if (handle >= Darray_length(self->positions) ||
+        self->positions[handle] == PRIORITY_QUEUE_NONE)
+    {
+        printf("PriorityQueue: refused to carry on with call to "
+               "PriorityQueue_decrease_key, handle is not in the queue\n");
+        return;
+    }
+    if (self->compare(element,
+                      PRIORITY_QUEUE_AT(self, self->positions[handle])) > 0)
+    {
+        printf("PriorityQueue: refused to carry on with call to "
+               "PriorityQueue_decrease_key, new element compares greater\n");
+        return;
+    }
+#endif
+    memcpy(self->scratch, element, self->element_size);
+    PriorityQueue_sift_up(self, self->positions[handle], handle);
+}
+
+#endif // #if defined(PRIORITY_QUEUE_INCLUDE_IMPLEMENTATION)
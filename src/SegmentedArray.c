@@ -0,0 +1,295 @@
+#ifndef SEGMENTED_ARRAY_H
+#define SEGMENTED_ARRAY_H
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * Segmented array: elements live in segments whose lengths double, segment k
+ * holds first << k elements. Growing allocates the next segment and never
+ * moves or copies existing elements, so pointers to elements stay valid until
+ * the element is popped or the array destroyed. The directory of segments is
+ * a fixed array inside the struct, it never moves either.
+ *
+ *   index + first = 2^(shift + k) + offset  ->  segment k, element offset
+ *
+ * so finding an element is one bit scan, a subtraction and two loads.
+ *
+ * The array is not synchronized, stable addresses only mean that pointers
+ * kept by the thread that owns the array survive its growth. Sharing it with
+ * concurrent appends takes an external lock, or ConcurrentArray.
+ */
+#define SEGMENTED_ARRAY_MAX_SEGMENTS 64
+
+typedef struct SegmentedArray
+{
+    void *segments[SEGMENTED_ARRAY_MAX_SEGMENTS];
+    size_t n_segments;
+    size_t n_elements;
+    size_t element_size;
+    size_t first_shift; // the first segment holds 1 << first_shift elements
+
+    void *(*allocator)(size_t);
+    void (*liberator)(void *);
+} SegmentedArray;
+
+// first_capacity is rounded up to a power of two
+SegmentedArray _SegmentedArray_create(size_t element_size,
+                                      size_t first_capacity,
+                                      void *(*allocator)(size_t),
+                                      void (*liberator)(void *));
+#define SegmentedArray_create(type, first_capacity)                            \
+    _SegmentedArray_create(sizeof(type), first_capacity, malloc, free)
+#define SegmentedArray_create_allocator(type, first_capacity, malloc, free)    \
+    _SegmentedArray_create(sizeof(type), first_capacity, malloc, free)
+
+void SegmentedArray_destroy(SegmentedArray *self);
+
+size_t SegmentedArray_length(SegmentedArray *self);
+size_t SegmentedArray_get_capacity(SegmentedArray *self);
+void *SegmentedArray_get(SegmentedArray *self, size_t index);
+
+void SegmentedArray_reserve(SegmentedArray *self, size_t n);
+// frees the segments past the last element
+void SegmentedArray_shrink_to_fit(SegmentedArray *self);
+
+void _SegmentedArray_push(SegmentedArray *self, void *element);
+#define SegmentedArray_push(self, element)                                     \
+    {                                                                          \
+        __auto_type SegmentedArray_push_temp_var = element;                    \
+        _SegmentedArray_push(self, &SegmentedArray_push_temp_var);             \
+    }
+
+void SegmentedArray_push_multiple(SegmentedArray *self, void *array, size_t n);
+
+void SegmentedArray_pop(SegmentedArray *self, void *out);
+void SegmentedArray_pop_multiple(SegmentedArray *self, void *out, size_t n);
+
+// calls function once per segment with its elements, in order
+void SegmentedArray_for_each_segment(SegmentedArray *self,
+                                     void (*function)(void *segment, size_t n,
+                                                      void *context),
+                                     void *context);
+
+// allocates a new Darray with a copy of the elements, using the C library
+// allocator since the array has no reallocator to pass on
+void *SegmentedArray_to_Darray(SegmentedArray *self);
+
+#endif // #ifndef SEGMENTED_ARRAY_H
+
+#if defined(SEGMENTED_ARRAY_INCLUDE_IMPLEMENTATION) &&                         \
+    !defined(SEGMENTED_ARRAY_IMPLEMENTATION_INCLUDED)
+#define SEGMENTED_ARRAY_IMPLEMENTATION_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+
+#define SEGMENTED_ARRAY_INTERNAL static inline
+
+// elements in segment k
+#define SEGMENTED_ARRAY_SEGMENT_LENGTH(self, k)                                \
+    ((size_t)1 << ((self)->first_shift + (k)))
+// elements in segments [0, k)
+#define SEGMENTED_ARRAY_SEGMENT_START(self, k)                                 \
+    (SEGMENTED_ARRAY_SEGMENT_LENGTH(self, k) -                                 \
+     ((size_t)1 << (self)->first_shift))
+
+SEGMENTED_ARRAY_INTERNAL void *SegmentedArray_at(SegmentedArray *self,
+                                                 size_t index)
+{
+    size_t biased = index + ((size_t)1 << self->first_shift);
+    size_t top = 63 - __builtin_clzll(biased);
+    size_t k = top - self->first_shift;
+    size_t offset = biased - ((size_t)1 << top);
+    return self->segments[k] + offset * self->element_size;
+}
+
+/* * * * CREATION AND DESTRUCTION * * * */
+
+SegmentedArray _SegmentedArray_create(size_t element_size,
+                                      size_t first_capacity,
+                                      void *(*allocator)(size_t),
+                                      void (*liberator)(void *))
+{
+    SegmentedArray result = {
+        .n_segments = 0,
+        .n_elements = 0,
+        .element_size = element_size,
+        .first_shift = 0,
+        .allocator = allocator,
+        .liberator = liberator,
+    };
+    while (((size_t)1 << result.first_shift) < first_capacity)
+    {
+        result.first_shift += 1;
+    }
+    return result;
+}
+
+void SegmentedArray_destroy(SegmentedArray *self)
+{
+    for (size_t k = 0; k < self->n_segments; k++)
+    {
+        self->liberator(self->segments[k]);
+    }
+    memset(self, 0, sizeof(SegmentedArray));
+}
+
+/* * * * GETTERS * * * */
+
+size_t SegmentedArray_length(SegmentedArray *self)
+{
+    return self->n_elements;
+}
+
+size_t SegmentedArray_get_capacity(SegmentedArray *self)
+{
+    return SEGMENTED_ARRAY_SEGMENT_START(self, self->n_segments);
+}
+
+void *SegmentedArray_get(SegmentedArray *self, size_t index)
+{
+#ifdef DARRAY_DEBUG
+    if (index >= self->n_elements)
+    {
+        printf("SegmentedArray: refused to carry on with call to "
+               "SegmentedArray_get, index overflows array length\n");
+        return NULL;
+    }
+#endif
+    return SegmentedArray_at(self, index);
+}
+
+/* * * *  RESIZING  * * * */
+/* * * * (Internal) * * * */
+
+// adds segments until n more elements fit, existing segments are untouched
+SEGMENTED_ARRAY_INTERNAL void SegmentedArray_check_full_and_resize(
+    SegmentedArray *self, size_t n)
+{
+    while (SegmentedArray_get_capacity(self) < self->n_elements + n)
+    {
+        size_t k = self->n_segments;
+        self->segments[k] = self->allocator(
+            SEGMENTED_ARRAY_SEGMENT_LENGTH(self, k) * self->element_size);
+        self->n_segments += 1;
+    }
+}
+
+void SegmentedArray_reserve(SegmentedArray *self, size_t n)
+{
+    if (n > self->n_elements)
+    {
+        SegmentedArray_check_full_and_resize(self, n - self->n_elements);
+    }
+}
+
+void SegmentedArray_shrink_to_fit(SegmentedArray *self)
+{
+    while (self->n_segments > 0 &&
+           SEGMENTED_ARRAY_SEGMENT_START(self, self->n_segments - 1) >=
+               self->n_elements)
+    {
+        self->n_segments -= 1;
+        self->liberator(self->segments[self->n_segments]);
+    }
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+void _SegmentedArray_push(SegmentedArray *self, void *element)
+{
+    SegmentedArray_check_full_and_resize(self, 1);
+    memcpy(SegmentedArray_at(self, self->n_elements), element,
+           self->element_size);
+    self->n_elements += 1;
+}
+
+// copies segment by segment, at most one memcpy per touched segment
+void SegmentedArray_push_multiple(SegmentedArray *self, void *array, size_t n)
+{
+    SegmentedArray_check_full_and_resize(self, n);
+    size_t start = self->n_elements;
+    size_t end = start + n;
+    while (n > 0)
+    {
+        void *destination = SegmentedArray_at(self, start);
+        size_t biased = start + ((size_t)1 << self->first_shift);
+        size_t room = ((size_t)2 << (63 - __builtin_clzll(biased))) - biased;
+        size_t chunk = n < room ? n : room;
+        memcpy(destination, array, chunk * self->element_size);
+        array += chunk * self->element_size;
+        start += chunk;
+        n -= chunk;
+    }
+    self->n_elements = end;
+}
+
+void SegmentedArray_pop(SegmentedArray *self, void *out)
+{
+    SegmentedArray_pop_multiple(self, out, 1);
+}
+
+// segments are kept for reuse, see SegmentedArray_shrink_to_fit
+void SegmentedArray_pop_multiple(SegmentedArray *self, void *out, size_t n)
+{
+#ifdef DARRAY_DEBUG
+    if (self->n_elements < n)
+    {
+        printf("SegmentedArray: refused to carry on with call to "
+               "SegmentedArray_pop_multiple, number of elements to pop is "
+               "greater than number of elements in the array\n");
+        return;
+    }
+#endif
+    if (out != NULL)
+    {
+        for (size_t i = self->n_elements - n; i < self->n_elements; i++)
+        {
+            memcpy(out, SegmentedArray_at(self, i), self->element_size);
+            out += self->element_size;
+        }
+    }
+    self->n_elements -= n;
+}
+
+/* * * * ITERATION AND CONVERSION * * * */
+
+void SegmentedArray_for_each_segment(SegmentedArray *self,
+                                     void (*function)(void *segment, size_t n,
+                                                      void *context),
+                                     void *context)
+{
+    for (size_t k = 0; k < self->n_segments; k++)
+    {
+        size_t start = SEGMENTED_ARRAY_SEGMENT_START(self, k);
+        if (start >= self->n_elements)
+        {
+            break;
+        }
+        size_t length = SEGMENTED_ARRAY_SEGMENT_LENGTH(self, k);
+        size_t n = self->n_elements - start < length ? self->n_elements - start
+                                                     : length;
+        function(self->segments[k], n, context);
+    }
+}
+
+SEGMENTED_ARRAY_INTERNAL void SegmentedArray_append_segment(void *segment,
+                                                            size_t n,
+                                                            void *context)
+{
+    _Darray_push_multiple(context, segment, n);
+}
+
+void *SegmentedArray_to_Darray(SegmentedArray *self)
+{
+    void *result = _Darray_create(self->element_size, self->n_elements + 1,
+                                  malloc, realloc, free);
+    SegmentedArray_for_each_segment(self, SegmentedArray_append_segment,
+                                    &result);
+    return result;
+}
+
+#endif // #if defined(SEGMENTED_ARRAY_INCLUDE_IMPLEMENTATION)
@@ -0,0 +1,319 @@
+#ifndef SORTED_ARRAY_H
+#define SORTED_ARRAY_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Darray.c"
+
+/*
+ * Sorted Darrays: binary search and ordered insertion over an ordinary Darray
+ * kept in ascending order of a qsort style comparator. The searches are
+ * branchless, every step picks the next half with a conditional move instead
+ * of a jump, and both possible next probes are prefetched while the current
+ * comparison is still in flight.
+ *
+ *   lower bound: first element not less than key
+ *   upper bound: first element greater than key
+ *
+ * Both return the length of the array when there is no such element.
+ */
+size_t Darray_lower_bound(void *data, const void *key,
+                          int (*compare)(const void *, const void *));
+size_t Darray_upper_bound(void *data, const void *key,
+                          int (*compare)(const void *, const void *));
+// the run of elements equal to key, empty and positioned at the lower bound
+// when there is none
+DarraySlice Darray_equal_range(void *data, const void *key,
+                               int (*compare)(const void *, const void *));
+
+// inserts after the elements equal to element and returns its index
+size_t _Darray_insert_sorted(void **, void *,
+                             int (*)(const void *, const void *));
+#define Darray_insert_sorted(data_p, element, compare)                         \
+    {                                                                          \
+        __auto_type Darray_push_temp_var = element;                            \
+        _Darray_insert_sorted((void **)data_p, &Darray_push_temp_var,          \
+                              compare);                                        \
+    }
+
+/*
+ * Eytzinger layout: a frozen copy of a sorted array stored in breadth first
+ * order of the implicit search tree, the children of slot k are slots 2k and
+ * 2k + 1 and slot 0 is unused. The first levels of every search share a few
+ * hot cache lines, and the 16 descendants four levels down are contiguous so
+ * they are prefetched with one request. Meant for read mostly lookup tables,
+ * it has to be rebuilt after the sorted array changes.
+ *
+ * The searches return a slot of the layout, 0 when there is no such element.
+ */
+#define SORTED_ARRAY_CACHE_LINE 64
+
+// allocates the layout as a new cache line aligned Darray of length n + 1
+void *Darray_eytzinger(void *sorted);
+size_t Darray_eytzinger_lower_bound(void *layout, const void *key,
+                                    int (*compare)(const void *,
+                                                   const void *));
+size_t Darray_eytzinger_upper_bound(void *layout, const void *key,
+                                    int (*compare)(const void *,
+                                                   const void *));
+
+/*
+ * Typed sorted arrays: SORTED_ARRAY_DEFINE(Keys, uint32_t, less) emits
+ * Keys_lower_bound, Keys_upper_bound, Keys_equal_range, Keys_insert,
+ * Keys_eytzinger, Keys_eytzinger_lower_bound and Keys_eytzinger_upper_bound.
+ * less(a, b) is a function or macro taking two values of type, with a plain
+ * comparison the searches compile to a compare and a conditional move per
+ * level. The functions work on ordinary Darrays and layouts.
+ */
+#define SORTED_ARRAY_DEFINE(name, type, less)                                  \
+    static inline size_t name##_lower_bound(type *data, type key)              \
+    {                                                                          \
+        size_t n = Darray_length(data);                                        \
+        if (n == 0)                                                            \
+        {                                                                      \
+            return 0;                                                          \
+        }                                                                      \
+        type *base = data;                                                     \
+        while (n > 1)                                                          \
+        {                                                                      \
+            size_t half = n / 2;                                               \
+            __builtin_prefetch(base + half / 2);                               \
+            __builtin_prefetch(base + half + half / 2);                        \
+            base = less(base[half], key) ? base + half : base;                 \
+            n -= half;                                                         \
+        }                                                                      \
+        return base - data + less(*base, key);                                 \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_upper_bound(type *data, type key)              \
+    {                                                                          \
+        size_t n = Darray_length(data);                                        \
+        if (n == 0)                                                            \
+        {                                                                      \
+            return 0;                                                          \
+        }                                                                      \
+        type *base = data;                                                     \
+        while (n > 1)                                                          \
+        {                                                                      \
+            size_t half = n / 2;                                               \
+            __builtin_prefetch(base + half / 2);                               \
+            __builtin_prefetch(base + half + half / 2);                        \
+            base = !less(key, base[half]) ? base + half : base;                \
+            n -= half;                                                         \
+        }                                                                      \
+        return base - data + !less(key, *base);                                \
+    }                                                                          \
+                                                                               \
+    static inline DarraySlice name##_equal_range(type *data, type key)         \
+    {                                                                          \
+        return Darray_slice(data, name##_lower_bound(data, key),               \
+                            name##_upper_bound(data, key));                    \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_insert(type **data_p, type element)            \
+    {                                                                          \
+        size_t index = name##_upper_bound(*data_p, element);                   \
+        Darray *self = GET_SELF((void *)*data_p);                              \
+        if (__builtin_expect(self->n_elements + 1 >= self->capacity, 0))       \
+        {                                                                      \
+            _Darray_make_room((void **)data_p, 1);                             \
+            self = GET_SELF((void *)*data_p);                                  \
+        }                                                                      \
+        type *data = *data_p;                                                  \
+        memmove(&data[index + 1], &data[index],                                \
+                (self->n_elements - index) * sizeof(type));                    \
+        DARRAY_STATS_MOVED(self, (self->n_elements - index) * sizeof(type));   \
+        data[index] = element;                                                 \
+        self->n_elements += 1;                                                 \
+        DARRAY_STATS_LENGTH(self, self->n_elements);                           \
+        return index;                                                          \
+    }                                                                          \
+                                                                               \
+    static inline type *name##_eytzinger(type *sorted)                         \
+    {                                                                          \
+        return Darray_eytzinger(sorted);                                       \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_eytzinger_lower_bound(type *layout, type key)  \
+    {                                                                          \
+        size_t n = Darray_length(layout) - 1;                                  \
+        size_t ahead = SORTED_ARRAY_CACHE_LINE / sizeof(type);                 \
+        size_t k = 1;                                                          \
+        while (k <= n)                                                         \
+        {                                                                      \
+            __builtin_prefetch(layout + k * (ahead ? ahead : 1));              \
+            k = 2 * k + less(layout[k], key);                                  \
+        }                                                                      \
+        return k >> __builtin_ffsll(~k);                                       \
+    }                                                                          \
+                                                                               \
+    static inline size_t name##_eytzinger_upper_bound(type *layout, type key)  \
+    {                                                                          \
+        size_t n = Darray_length(layout) - 1;                                  \
+        size_t ahead = SORTED_ARRAY_CACHE_LINE / sizeof(type);                 \
+        size_t k = 1;                                                          \
+        while (k <= n)                                                         \
+        {                                                                      \
+            __builtin_prefetch(layout + k * (ahead ? ahead : 1));              \
+            k = 2 * k + !less(key, layout[k]);                                 \
+        }                                                                      \
+        return k >> __builtin_ffsll(~k);                                       \
+    }
+
+#endif // #ifndef SORTED_ARRAY_H
+
+#if defined(SORTED_ARRAY_INCLUDE_IMPLEMENTATION) &&                            \
+    !defined(SORTED_ARRAY_IMPLEMENTATION_INCLUDED)
+#define SORTED_ARRAY_IMPLEMENTATION_INCLUDED
+
+#include <stdio.h>
+
+#define SORTED_ARRAY_INTERNAL static inline
+
+/* * * *  SEARCH  * * * */
+/* * * * (Internal) * * * */
+
+// elements compare below bias advance the search: 0 finds the lower bound,
+// 1 the upper bound
+SORTED_ARRAY_INTERNAL size_t SortedArray_bound(
+    void *data, size_t n, size_t element_size, const void *key,
+    int (*compare)(const void *, const void *), int bias)
+{
+    if (n == 0)
+    {
+        return 0;
+    }
+    void *base = data;
+    while (n > 1)
+    {
+        size_t half = n / 2;
+        // the next probe is in one of the two halves, fetch both
+        __builtin_prefetch(base + (half / 2) * element_size);
+        __builtin_prefetch(base + (half + half / 2) * element_size);
+        base = compare(base + half * element_size, key) < bias
+                   ? base + half * element_size
+                   : base;
+        n -= half;
+    }
+    return (base - data) / element_size + (compare(base, key) < bias);
+}
+
+// descends the implicit tree, every right turn appends a 1 bit to k. The
+// answer is the last node where the search turned left, found by stripping
+// the trailing right turns and that left turn.
+SORTED_ARRAY_INTERNAL size_t SortedArray_eytzinger_bound(
+    void *layout, const void *key, int (*compare)(const void *, const void *),
+    int bias)
+{
+    Darray *self = GET_SELF(layout);
+    size_t n = self->n_elements - 1;
+    size_t element_size = self->element_size;
+    size_t ahead = SORTED_ARRAY_CACHE_LINE / element_size;
+    ahead = ahead ? ahead : 1;
+    size_t k = 1;
+    while (k <= n)
+    {
+        __builtin_prefetch(layout + k * ahead * element_size);
+        k = 2 * k + (compare(layout + k * element_size, key) < bias);
+    }
+    return k >> __builtin_ffsll(~k);
+}
+
+// in order walk of the implicit tree, i is the next sorted element to place
+SORTED_ARRAY_INTERNAL size_t SortedArray_eytzinger_fill(void *layout,
+                                                        void *sorted,
+                                                        size_t element_size,
+                                                        size_t n, size_t i,
+                                                        size_t k)
+{
+    if (k <= n)
+    {
+        i = SortedArray_eytzinger_fill(layout, sorted, element_size, n, i,
+                                       2 * k);
+        memcpy(layout + k * element_size, sorted + i * element_size,
+               element_size);
+        i = SortedArray_eytzinger_fill(layout, sorted, element_size, n, i + 1,
+                                       2 * k + 1);
+    }
+    return i;
+}
+
+/* * * * SEARCH * * * */
+
+size_t Darray_lower_bound(void *data, const void *key,
+                          int (*compare)(const void *, const void *))
+{
+    Darray *self = GET_SELF(data);
+    return SortedArray_bound(data, self->n_elements, self->element_size, key,
+                             compare, 0);
+}
+
+size_t Darray_upper_bound(void *data, const void *key,
+                          int (*compare)(const void *, const void *))
+{
+    Darray *self = GET_SELF(data);
+    return SortedArray_bound(data, self->n_elements, self->element_size, key,
+                             compare, 1);
+}
+
+// the upper bound is searched for only past the lower bound
+DarraySlice Darray_equal_range(void *data, const void *key,
+                               int (*compare)(const void *, const void *))
+{
+    Darray *self = GET_SELF(data);
+    size_t start = Darray_lower_bound(data, key, compare);
+    size_t end = start + SortedArray_bound(
+                             data + start * self->element_size,
+                             self->n_elements - start, self->element_size,
+                             key, compare, 1);
+    return Darray_slice(data, start, end);
+}
+
+/* * * * ELEMENT MANIPULATION * * * */
+
+size_t _Darray_insert_sorted(void **data_p, void *element,
+                             int (*compare)(const void *, const void *))
+{
+    size_t index = Darray_upper_bound(*data_p, element, compare);
+    if (index == Darray_length(*data_p))
+    {
+        _Darray_push(data_p, element);
+    }
+    else
+    {
+        _Darray_push_middle(data_p, index, element);
+    }
+    return index;
+}
+
+/* * * * EYTZINGER LAYOUT * * * */
+
+void *Darray_eytzinger(void *sorted)
+{
+    Darray *self = GET_SELF(sorted);
+    size_t n = self->n_elements;
+    void *layout =
+        _Darray_create_aligned(self->element_size, n + 2,
+                               SORTED_ARRAY_CACHE_LINE, malloc, realloc, free);
+    memset(layout, 0, self->element_size);
+    SortedArray_eytzinger_fill(layout, sorted, self->element_size, n, 0, 1);
+    (GET_SELF(layout))->n_elements = n + 1;
+    return layout;
+}
+
+size_t Darray_eytzinger_lower_bound(void *layout, const void *key,
+                                    int (*compare)(const void *,
+                                                   const void *))
+{
+    return SortedArray_eytzinger_bound(layout, key, compare, 0);
+}
+
+size_t Darray_eytzinger_upper_bound(void *layout, const void *key,
+                                    int (*compare)(const void *,
+                                                   const void *))
+{
+    return SortedArray_eytzinger_bound(layout, key, compare, 1);
+}
+
+#endif // #if defined(SORTED_ARRAY_INCLUDE_IMPLEMENTATION)
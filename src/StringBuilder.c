@@ -0,0 +1,241 @@
+#ifndef STRING_BUILDER_H
+#define STRING_BUILDER_H
+
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "Darray.c"
+
+/*
+ * String builder: a char Darray that always has a NUL after its last
+ * character, in the spare capacity that every Darray keeps, so the builder
+ * can be passed anywhere a C string is expected. Its length does not count
+ * the NUL. Appending is amortized O(length appended), formatted appends
+ * print straight into the spare capacity and only print a second time when
+ * the result did not fit. Destroy it with Darray_destroy.
+ *
+ *   char *line = StringBuilder_create(64);
+ *   StringBuilder_append(&line, "x = ");
+ *   StringBuilder_append_int(&line, 42);
+ *   puts(line);
+ */
+char *_StringBuilder_create(size_t capacity, void *(*allocator)(size_t),
+                            void *(*reallocator)(void *, size_t),
+                            void (*liberator)(void *));
+#define StringBuilder_create(capacity)                                         \
+    _StringBuilder_create(capacity, malloc, realloc, free)
+#define StringBuilder_create_allocator(capacity, malloc, realloc, free)        \
+    _StringBuilder_create(capacity, malloc, realloc, free)
+
+// empties the builder and keeps its capacity
+void StringBuilder_reset(char *builder);
+
+void StringBuilder_append(char **builder_p, const char *string);
+void StringBuilder_append_n(char **builder_p, const char *string, size_t n);
+void StringBuilder_append_char(char **builder_p, char c);
+void StringBuilder_append_format(char **builder_p, const char *format, ...)
+    __attribute__((format(printf, 2, 3)));
+void StringBuilder_append_format_va(char **builder_p, const char *format,
+                                    va_list args);
+
+// decimal conversions without going through the printf machinery
+void StringBuilder_append_int(char **builder_p, int64_t value);
+void StringBuilder_append_uint(char **builder_p, uint64_t value);
+// same digits as "%.*f", precision is clamped to [0, 17]
+void StringBuilder_append_float(char **builder_p, double value,
+                                int precision);
+
+#endif // #ifndef STRING_BUILDER_H
+
+#if defined(STRING_BUILDER_INCLUDE_IMPLEMENTATION) &&                          \
+    !defined(STRING_BUILDER_IMPLEMENTATION_INCLUDED)
+#define STRING_BUILDER_IMPLEMENTATION_INCLUDED
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STRING_BUILDER_INTERNAL static inline
+
+// the longest uint64_t has 20 digits
+#define STRING_BUILDER_DIGITS 20
+
+static const char StringBuilder_digit_pairs[201] =
+    "00010203040506070809"
+    "10111213141516171819"
+    "20212223242526272829"
+    "30313233343536373839"
+    "40414243444546474849"
+    "50515253545556575859"
+    "60616263646566676869"
+    "70717273747576777879"
+    "80818283848586878889"
+    "90919293949596979899";
+
+/* * * *   DIGITS   * * * */
+/* * * * (Internal) * * * */
+
+// writes value backwards ending at end, two digits per division, and returns
+// the first digit. At least width digits are written, padded with zeros.
+STRING_BUILDER_INTERNAL char *StringBuilder_digits(char *end, uint64_t value,
+                                                   size_t width)
+{
+    char *start = end;
+    while (value >= 100)
+    {
+        size_t pair = (value % 100) * 2;
+        value /= 100;
+        start -= 2;
+        memcpy(start, &StringBuilder_digit_pairs[pair], 2);
+    }
+    if (value >= 10)
+    {
+        start -= 2;
+        memcpy(start, &StringBuilder_digit_pairs[value * 2], 2);
+    }
+    else
+    {
+        *--start = '0' + value;
+    }
+    while ((size_t)(end - start) < width)
+    {
+        *--start = '0';
+    }
+    return start;
+}
+
+/* * * * CREATION * * * */
+
+char *_StringBuilder_create(size_t capacity, void *(*allocator)(size_t),
+                            void *(*reallocator)(void *, size_t),
+                            void (*liberator)(void *))
+{
+    char *result =
+        _Darray_create(sizeof(char), capacity + 1, allocator, reallocator,
+                       liberator);
+    result[0] = 0;
+    return result;
+}
+
+void StringBuilder_reset(char *builder)
+{
+    (GET_SELF(builder))->n_elements = 0;
+    builder[0] = 0;
+}
+
+/* * * * APPENDING * * * */
+
+// a push of n leaves n_elements + n below the capacity, so the NUL fits
+void StringBuilder_append_n(char **builder_p, const char *string, size_t n)
+{
+    _Darray_push_multiple((void **)builder_p, (void *)string, n);
+    (*builder_p)[Darray_length(*builder_p)] = 0;
+}
+
+void StringBuilder_append(char **builder_p, const char *string)
+{
+    StringBuilder_append_n(builder_p, string, strlen(string));
+}
+
+void StringBuilder_append_char(char **builder_p, char c)
+{
+    StringBuilder_append_n(builder_p, &c, 1);
+}
+
+void StringBuilder_append_format(char **builder_p, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    StringBuilder_append_format_va(builder_p, format, args);
+    va_end(args);
+}
+
+void StringBuilder_append_format_va(char **builder_p, const char *format,
+                                    va_list args)
+{
+    Darray *self = GET_SELF(*builder_p);
+    size_t length = self->n_elements;
+    va_list retry;
+    va_copy(retry, args);
+    int n = vsnprintf(*builder_p + length, self->capacity - length, format,
+                      args);
+    if (n < 0)
+    {
+        (*builder_p)[length] = 0;
+    }
+    else if ((size_t)n >= self->capacity - length)
+    {
+        _Darray_make_room((void **)builder_p, n);
+        self = GET_SELF(*builder_p);
+        vsnprintf(*builder_p + length, self->capacity - length, format, retry);
+        self->n_elements += n;
+    }
+    else
+    {
+        self->n_elements += n;
+    }
+    DARRAY_STATS_LENGTH(self, self->n_elements);
+    va_end(retry);
+}
+
+void StringBuilder_append_uint(char **builder_p, uint64_t value)
+{
+    char buffer[STRING_BUILDER_DIGITS];
+    char *end = buffer + sizeof(buffer);
+    char *start = StringBuilder_digits(end, value, 1);
+    StringBuilder_append_n(builder_p, start, end - start);
+}
+
+void StringBuilder_append_int(char **builder_p, int64_t value)
+{
+    char buffer[STRING_BUILDER_DIGITS + 1];
+    char *end = buffer + sizeof(buffer);
+    // negating in unsigned arithmetic also works for INT64_MIN
+    uint64_t magnitude = value < 0 ? -(uint64_t)value : (uint64_t)value;
+    char *start = StringBuilder_digits(end, magnitude, 1);
+    if (value < 0)
+    {
+        *--start = '-';
+    }
+    StringBuilder_append_n(builder_p, start, end - start);
+}
+
+// scales by 10^precision and rounds to an integer, then prints the integer
+// and fractional digits. That is exact unless the scaled value is within a
+// few ulps of a rounding tie or too large for the integer, then snprintf
+// decides.
+void StringBuilder_append_float(char **builder_p, double value,
+                                int precision)
+{
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,
+                                    1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17};
+    precision = precision < 0 ? 0 : precision > 17 ? 17 : precision;
+    double scaled = fabs(value) * powers[precision];
+    double fraction = scaled - floor(scaled);
+    if (!(scaled < 0x1p53) || fabs(fraction - 0.5) < scaled * 0x1p-50)
+    {
+        StringBuilder_append_format(builder_p, "%.*f", precision, value);
+        return;
+    }
+    uint64_t rounded = (uint64_t)nearbyint(scaled);
+    uint64_t unit = (uint64_t)powers[precision];
+
+    char buffer[2 * STRING_BUILDER_DIGITS + 2];
+    char *end = buffer + sizeof(buffer);
+    char *start = end;
+    if (precision > 0)
+    {
+        start = StringBuilder_digits(end, rounded % unit, precision);
+        *--start = '.';
+    }
+    start = StringBuilder_digits(start, rounded / unit, 1);
+    if (signbit(value))
+    {
+        *--start = '-';
+    }
+    StringBuilder_append_n(builder_p, start, end - start);
+}
+
+#endif // #if defined(STRING_BUILDER_INCLUDE_IMPLEMENTATION)
@@ -0,0 +1,149 @@
+#ifndef STRUCT_OF_ARRAYS_H
+#define STRUCT_OF_ARRAYS_H
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "Darray.c"
+
+/*
+ * Structure of arrays: STRUCT_OF_ARRAYS_DEFINE(Particles, PARTICLE_FIELDS)
+ * stores every field of a record in its own column, so a loop over one field
+ * reads only that field and vectorizes over a plain array. fields is an X
+ * macro that applies its argument to every (type, name) pair:
+ *
+ *   #define PARTICLE_FIELDS(FIELD)                                          \
+ *       FIELD(float, x)                                                     \
+ *       FIELD(float, y)                                                     \
+ *       FIELD(uint32_t, id)
+ *   STRUCT_OF_ARRAYS_DEFINE(Particles, PARTICLE_FIELDS)
+ *
+ * emits the container Particles, with a Darray member per column plus the
+ * shared length and capacity, the record type Particles_element and
+ * Particles_create, _create_allocator, _destroy, _reserve, _push, _pop,
+ * _swap_remove, _get and _set. Every column is a cache line aligned Darray,
+ * they grow together through the Darray growth policy, so a push checks the
+ * capacity once for all columns. Popping never releases memory.
+ *
+ *   float *x = StructOfArrays_column(&particles, x);
+ *   for (size_t i = 0; i < particles.length; i++) x[i] += dx;
+ */
+#define STRUCT_OF_ARRAYS_ALIGNMENT 64
+
+// the column as a plain pointer the compiler knows to be aligned
+#define StructOfArrays_column(self, field)                                     \
+    ((__typeof__((self)->field))__builtin_assume_aligned(                      \
+        (self)->field, STRUCT_OF_ARRAYS_ALIGNMENT))
+
+// what the field list expands to inside the generated functions
+#define STRUCT_OF_ARRAYS_MEMBER(type, field) type field;
+#define STRUCT_OF_ARRAYS_COLUMN(type, field) type *field;
+#define STRUCT_OF_ARRAYS_CREATE(type, field)                                   \
+    result.field = _Darray_create_aligned(sizeof(type), capacity,              \
+                                          STRUCT_OF_ARRAYS_ALIGNMENT,          \
+                                          allocator, reallocator, liberator);  \
+    result.capacity = Darray_get_capacity(result.field);
+#define STRUCT_OF_ARRAYS_DESTROY(type, field) Darray_destroy(self->field);
+#define STRUCT_OF_ARRAYS_RESERVE(type, field)                                  \
+    _Darray_reserve((void **)&self->field, n);                                 \
+    self->capacity = Darray_get_capacity(self->field);
+#define STRUCT_OF_ARRAYS_GROW(type, field)                                     \
+    _Darray_make_room((void **)&self->field, n);                               \
+    self->capacity = Darray_get_capacity(self->field);
+// the column headers keep their own length so the generic Darray functions
+// work on single columns
+#define STRUCT_OF_ARRAYS_SET_LENGTH(type, field)                               \
+    (GET_SELF((void *)self->field))->n_elements = self->length;                \
+    DARRAY_STATS_LENGTH(GET_SELF((void *)self->field), self->length);
+#define STRUCT_OF_ARRAYS_STORE(type, field)                                    \
+    self->field[index] = element.field;
+#define STRUCT_OF_ARRAYS_LOAD(type, field) result.field = self->field[index];
+#define STRUCT_OF_ARRAYS_MOVE_LAST(type, field)                                \
+    self->field[index] = self->field[self->length];
+
+#define STRUCT_OF_ARRAYS_DEFINE(name, fields)                                  \
+    typedef struct name##_element                                              \
+    {                                                                          \
+        fields(STRUCT_OF_ARRAYS_MEMBER)                                        \
+    } name##_element;                                                          \
+                                                                               \
+    typedef struct name                                                        \
+    {                                                                          \
+        size_t length;                                                         \
+        size_t capacity;                                                       \
+        fields(STRUCT_OF_ARRAYS_COLUMN)                                        \
+    } name;                                                                    \
+                                                                               \
+    static inline name name##_create_allocator(                                \
+        size_t capacity, void *(*allocator)(size_t),                           \
+        void *(*reallocator)(void *, size_t), void (*liberator)(void *))       \
+    {                                                                          \
+        name result = {0};                                                     \
+        fields(STRUCT_OF_ARRAYS_CREATE)                                        \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    static inline name name##_create(size_t capacity)                          \
+    {                                                                          \
+        return name##_create_allocator(capacity, malloc, realloc, free);       \
+    }                                                                          \
+                                                                               \
+    static inline void name##_destroy(name *self)                              \
+    {                                                                          \
+        fields(STRUCT_OF_ARRAYS_DESTROY)                                       \
+        memset(self, 0, sizeof(name));                                         \
+    }                                                                          \
+                                                                               \
+    static inline void name##_reserve(name *self, size_t n)                    \
+    {                                                                          \
+        fields(STRUCT_OF_ARRAYS_RESERVE)                                       \
+    }                                                                          \
+                                                                               \
+    static inline void name##_push(name *self, name##_element element)         \
+    {                                                                          \
+        if (__builtin_expect(self->length + 1 >= self->capacity, 0))           \
+        {                                                                      \
+            size_t n = 1;                                                      \
+            fields(STRUCT_OF_ARRAYS_GROW)                                      \
+        }                                                                      \
+        size_t index = self->length;                                           \
+        fields(STRUCT_OF_ARRAYS_STORE)                                         \
+        self->length += 1;                                                     \
+        fields(STRUCT_OF_ARRAYS_SET_LENGTH)                                    \
+    }                                                                          \
+                                                                               \
+    static inline name##_element name##_pop(name *self)                        \
+    {                                                                          \
+        name##_element result;                                                 \
+        self->length -= 1;                                                     \
+        size_t index = self->length;                                           \
+        fields(STRUCT_OF_ARRAYS_LOAD)                                          \
+        fields(STRUCT_OF_ARRAYS_SET_LENGTH)                                    \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    /* the last record fills the hole, O(1) but does not keep the order */     \
+    static inline name##_element name##_swap_remove(name *self, size_t index)  \
+    {                                                                          \
+        name##_element result;                                                 \
+        fields(STRUCT_OF_ARRAYS_LOAD)                                          \
+        self->length -= 1;                                                     \
+        fields(STRUCT_OF_ARRAYS_MOVE_LAST)                                     \
+        fields(STRUCT_OF_ARRAYS_SET_LENGTH)                                    \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    static inline name##_element name##_get(name *self, size_t index)          \
+    {                                                                          \
+        name##_element result;                                                 \
+        fields(STRUCT_OF_ARRAYS_LOAD)                                          \
+        return result;                                                         \
+    }                                                                          \
+                                                                               \
+    static inline void name##_set(name *self, size_t index,                    \
+                                  name##_element element)                      \
+    {                                                                          \
+        fields(STRUCT_OF_ARRAYS_STORE)                                         \
+    }
+
+#endif // #ifndef STRUCT_OF_ARRAYS_H
@@ -0,0 +1,118 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define BITSET_INCLUDE_IMPLEMENTATION
+#include "../src/Bitset.c"
+
+// the reference every bitset is checked against, one byte per bit
+void check_against(Bitset *bits, uint8_t *bytes)
+{
+    size_t n = Darray_length(bytes);
+    assert(Bitset_length(bits) == n);
+    size_t count = 0;
+    for (size_t i = 0; i < n; i++)
+    {
+        assert(Bitset_test(bits, i) == bytes[i]);
+        count += bytes[i];
+    }
+    assert(Bitset_count(bits) == count);
+
+    size_t expected = 0;
+    Bitset_for_each(bits, index)
+    {
+        while (!bytes[expected])
+        {
+            expected++;
+        }
+        assert(index == expected);
+        expected++;
+    }
+    while (expected < n)
+    {
+        assert(!bytes[expected]);
+        expected++;
+    }
+}
+
+int main()
+{
+    uint32_t state = 5;
+    Bitset bits = Bitset_create(1);
+    uint8_t *bytes = Darray_create(uint8_t, 1);
+    for (int i = 0; i < 3000; i++)
+    {
+        state = state * 1103515245 + 12345;
+        // long clear runs exercise the word skipping
+        bool value = (state >> 16) % 61 == 0;
+        Bitset_push(&bits, value);
+        Darray_push(&bytes, (uint8_t)value);
+    }
+    check_against(&bits, bytes);
+
+    Bitset_set(&bits, 0);
+    bytes[0] = 1;
+    Bitset_set(&bits, 2999);
+    bytes[2999] = 1;
+    Bitset_clear(&bits, 64);
+    bytes[64] = 0;
+    check_against(&bits, bytes);
+    assert(Bitset_find_next(&bits, 3000) == BITSET_NONE);
+    assert(Bitset_find_next(&bits, 2999) == 2999);
+
+    // bulk operations against a second pattern of the same length
+    Bitset other = Bitset_create_allocator(0, malloc, realloc, free);
+    Bitset_resize(&other, 3000);
+    assert(Bitset_count(&other) == 0);
+    for (size_t i = 0; i < 3000; i += 3)
+    {
+        Bitset_set(&other, i);
+    }
+    Bitset and = Bitset_create(3000), or = Bitset_create(3000),
+           xor = Bitset_create(3000), andnot = Bitset_create(3000);
+    Bitset *results[] = {&and, &or, &xor, &andnot};
+    for (size_t r = 0; r < 4; r++)
+    {
+        Bitset_resize(results[r], 3000);
+        Bitset_or(results[r], &bits);
+    }
+    Bitset_and(&and, &other);
+    Bitset_or(&or, &other);
+    Bitset_xor(&xor, &other);
+    Bitset_andnot(&andnot, &other);
+    for (size_t i = 0; i < 3000; i++)
+    {
+        bool a = bytes[i], b = i % 3 == 0;
+        assert(Bitset_test(&and, i) == (a && b));
+        assert(Bitset_test(&or, i) == (a || b));
+        assert(Bitset_test(&xor, i) == (a != b));
+        assert(Bitset_test(&andnot, i) == (a && !b));
+    }
+    for (size_t r = 0; r < 4; r++)
+    {
+        Bitset_destroy(results[r]);
+    }
+
+    // filling and shrinking keep the bits past the length clear
+    Bitset_fill(&other, true);
+    assert(Bitset_count(&other) == 3000);
+    Bitset_resize(&other, 70);
+    assert(Bitset_count(&other) == 70);
+    Bitset_resize(&other, 200);
+    assert(Bitset_count(&other) == 70);
+    assert(Bitset_find_next(&other, 70) == BITSET_NONE);
+    Bitset_push(&other, true);
+    assert(Bitset_test(&other, 200) && Bitset_count(&other) == 71);
+    Bitset_destroy(&other);
+
+    Bitset_fill(&bits, false);
+    assert(Bitset_count(&bits) == 0);
+    assert(Bitset_find_next(&bits, 0) == BITSET_NONE);
+    Bitset_destroy(&bits);
+    Darray_destroy(bytes);
+
+    printf("bitset tests passed\n");
+    return 0;
+}
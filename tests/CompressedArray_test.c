@@ -0,0 +1,140 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define COMPRESSED_ARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/CompressedArray.c"
+
+size_t allocations = 0;
+
+void *counting_malloc(size_t size)
+{
+    allocations += 1;
+    return malloc(size);
+}
+
+// every access path has to give back the original values
+void check_roundtrip(uint64_t *values)
+{
+    size_t n = Darray_length(values);
+    CompressedArray compressed = CompressedArray_from_Darray(values);
+    CompressedArray pushed = CompressedArray_create();
+    for (size_t i = 0; i < n; i++)
+    {
+        CompressedArray_push(&pushed, values[i]);
+    }
+    assert(CompressedArray_length(&compressed) == n);
+    assert(CompressedArray_length(&pushed) == n);
+    assert(CompressedArray_size(&pushed) == CompressedArray_size(&compressed));
+    for (size_t i = 0; i < n; i++)
+    {
+        assert(CompressedArray_get(&compressed, i) == values[i]);
+        assert(CompressedArray_get(&pushed, i) == values[i]);
+    }
+
+    uint64_t *decoded = CompressedArray_to_Darray(&compressed);
+    assert(Darray_length(decoded) == n);
+    assert(memcmp(decoded, values, n * sizeof(uint64_t)) == 0);
+    // ranges starting and ending inside blocks and inside the tail
+    size_t starts[] = {0, 1, 127, 128, 200, n / 2};
+    for (size_t s = 0; s < sizeof(starts) / sizeof(*starts); s++)
+    {
+        size_t start = starts[s] < n ? starts[s] : n;
+        size_t count = (n - start) / 2 + (n - start) % 2;
+        memset(decoded, 0, n * sizeof(uint64_t));
+        CompressedArray_decode(&pushed, start, count, decoded);
+        assert(memcmp(decoded, values + start, count * sizeof(uint64_t)) ==
+               0);
+    }
+    Darray_destroy(decoded);
+    CompressedArray_destroy(&compressed);
+    CompressedArray_destroy(&pushed);
+}
+
+int main()
+{
+    uint32_t state = 11;
+    size_t lengths[] = {0, 1, 127, 128, 129, 1000, 4096};
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(*lengths); l++)
+    {
+        size_t n = lengths[l];
+        uint64_t *sorted = Darray_create(uint64_t, n + 1);
+        uint64_t *clustered = Darray_create(uint64_t, n + 1);
+        uint64_t *random = Darray_create(uint64_t, n + 1);
+        uint64_t *constant = Darray_create(uint64_t, n + 1);
+        uint64_t id = (uint64_t)1 << 40;
+        for (size_t i = 0; i < n; i++)
+        {
+            state = state * 1103515245 + 12345;
+            id += (state >> 16) % 1000;
+            Darray_push(&sorted, id);
+            Darray_push(&clustered, (i / 500 << 32) + (state >> 20));
+            uint64_t high = state;
+            state = state * 1103515245 + 12345;
+            Darray_push(&random, high << 32 | state);
+            Darray_push(&constant, (uint64_t)42);
+        }
+        // full width values and both ends of the range
+        if (n > 2)
+        {
+            random[0] = UINT64_MAX;
+            random[1] = 0;
+        }
+        check_roundtrip(sorted);
+        check_roundtrip(clustered);
+        check_roundtrip(random);
+        check_roundtrip(constant);
+        Darray_destroy(sorted);
+        Darray_destroy(clustered);
+        Darray_destroy(random);
+        Darray_destroy(constant);
+    }
+
+    // 32 bit sources, and the memory saved on sorted ids
+    uint32_t *small = Darray_create(uint32_t, 4);
+    uint64_t *ids = Darray_create(uint64_t, 4);
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        Darray_push(&small, 3000000000u + i * 3);
+        Darray_push(&ids, (uint64_t)i * 1000 + 123456789);
+    }
+    CompressedArray compressed = CompressedArray_from_Darray(small);
+    for (uint32_t i = 0; i < 100000; i++)
+    {
+        assert(CompressedArray_get(&compressed, i) == small[i]);
+    }
+    assert(CompressedArray_size(&compressed) * 8 < 100000 * 8);
+    CompressedArray_destroy(&compressed);
+
+    compressed = CompressedArray_from_Darray(ids);
+    assert(CompressedArray_size(&compressed) * 4 < 100000 * 8);
+    check_roundtrip(ids);
+    CompressedArray_destroy(&compressed);
+    Darray_destroy(small);
+
+    // the decompressed copy comes from the hooks of the compressed array
+    compressed =
+        _CompressedArray_from_Darray(ids, counting_malloc, realloc, free);
+    size_t before = allocations;
+    uint64_t *decoded = CompressedArray_to_Darray(&compressed);
+    assert(allocations == before + 1);
+    assert(decoded[99999] == ids[99999]);
+    Darray_destroy(decoded);
+    CompressedArray_destroy(&compressed);
+    Darray_destroy(ids);
+
+    // other widths are refused in every build
+    uint16_t *shorts = Darray_create(uint16_t, 4);
+    Darray_push(&shorts, (uint16_t)7);
+    Darray_push(&shorts, (uint16_t)9);
+    compressed = CompressedArray_from_Darray(shorts);
+    assert(CompressedArray_length(&compressed) == 0);
+    CompressedArray_destroy(&compressed);
+    Darray_destroy(shorts);
+
+    printf("compressed array tests passed\n");
+    return 0;
+}
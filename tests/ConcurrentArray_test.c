@@ -0,0 +1,93 @@
+#include <assert.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define CONCURRENT_ARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/ConcurrentArray.c"
+
+#define THREADS 8
+#define PER_THREAD 50000
+
+// every segment is allocated once, by the thread that claimed it
+atomic_size_t allocations;
+
+void *counting_malloc(size_t size)
+{
+    atomic_fetch_add(&allocations, 1);
+    return malloc(size);
+}
+
+typedef struct Producer
+{
+    ConcurrentArray *array;
+    uint32_t id;
+} Producer;
+
+void *produce(void *arg)
+{
+    Producer *producer = arg;
+    uint32_t base = producer->id * PER_THREAD;
+    // a third each through push, push_multiple and a writer
+    for (uint32_t i = 0; i < PER_THREAD / 3; i++)
+    {
+        ConcurrentArray_push(producer->array, base + i);
+    }
+    uint32_t block[100];
+    uint32_t i = PER_THREAD / 3;
+    for (; i + 100 <= 2 * PER_THREAD / 3; i += 100)
+    {
+        for (uint32_t j = 0; j < 100; j++)
+        {
+            block[j] = base + i + j;
+        }
+        ConcurrentArray_push_multiple(producer->array, block, 100);
+    }
+    ConcurrentArrayWriter writer = ConcurrentArray_writer(producer->array);
+    for (; i < PER_THREAD; i++)
+    {
+        ConcurrentArrayWriter_push(&writer, base + i);
+    }
+    ConcurrentArrayWriter_flush(&writer);
+    return NULL;
+}
+
+int main()
+{
+    ConcurrentArray *array =
+        ConcurrentArray_create_allocator(uint32_t, 3, counting_malloc, free);
+    pthread_t threads[THREADS];
+    Producer producers[THREADS];
+    for (uint32_t t = 0; t < THREADS; t++)
+    {
+        producers[t] = (Producer){.array = array, .id = t};
+        pthread_create(&threads[t], NULL, produce, &producers[t]);
+    }
+    for (int t = 0; t < THREADS; t++)
+    {
+        pthread_join(threads[t], NULL);
+    }
+    assert(ConcurrentArray_length(array) == THREADS * PER_THREAD);
+
+    // every value exactly once
+    uint32_t *values = ConcurrentArray_to_Darray(array);
+    assert(*(uint32_t *)ConcurrentArray_get(array, 12345) == values[12345]);
+    Darray_sort(values, DARRAY_U32);
+    for (uint32_t i = 0; i < THREADS * PER_THREAD; i++)
+    {
+        assert(values[i] == i);
+    }
+    Darray_destroy(values);
+    size_t segments = 0;
+    for (size_t k = 0; k < CONCURRENT_ARRAY_MAX_SEGMENTS; k++)
+    {
+        segments += atomic_load(&array->segments[k]) != NULL;
+    }
+    assert(atomic_load(&allocations) == 1 + segments);
+    ConcurrentArray_destroy(array);
+
+    printf("concurrent array tests passed\n");
+    return 0;
+}
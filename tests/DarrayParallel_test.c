@@ -0,0 +1,166 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define DARRAY_PARALLEL_INCLUDE_IMPLEMENTATION
+#include "../src/DarrayParallel.c"
+
+void square(void *chunk, size_t n, size_t start_index, void *context)
+{
+    int64_t *values = chunk;
+    for (size_t i = 0; i < n; i++)
+    {
+        values[i] = (int64_t)(start_index + i) * (int64_t)(start_index + i);
+    }
+}
+
+void sum_chunk(void *accumulator, const void *chunk, size_t n, void *context)
+{
+    const int64_t *values = chunk;
+    int64_t *sum = accumulator;
+    for (size_t i = 0; i < n; i++)
+    {
+        *sum += values[i];
+    }
+}
+
+void sum_partial(void *accumulator, const void *partial, void *context)
+{
+    *(int64_t *)accumulator += *(const int64_t *)partial;
+}
+
+void add(void *accumulator, const void *element)
+{
+    *(int64_t *)accumulator += *(const int64_t *)element;
+}
+
+// accumulators that carry a tag, combine only ever sees tagged operands
+typedef struct Tagged
+{
+    uint64_t tag;
+    int64_t value;
+} Tagged;
+
+uint64_t scan_tag;
+
+void add_tagged(void *accumulator, const void *element)
+{
+    Tagged *a = accumulator;
+    const Tagged *e = element;
+    assert(a->tag == scan_tag && e->tag == scan_tag);
+    a->value += e->value;
+}
+
+int compare_u32(const void *a, const void *b)
+{
+    uint32_t left = *(const uint32_t *)a, right = *(const uint32_t *)b;
+    return (left > right) - (left < right);
+}
+
+// counts the tasks of one job, the counter lives on the stack of the caller
+void count_task(void *argument, size_t index)
+{
+    atomic_fetch_add((atomic_size_t *)argument, 1);
+}
+
+// many short jobs back to back, a worker that wakes up late must not run
+// tasks of a job that already returned
+void test_back_to_back(DarrayPool *pool)
+{
+    for (size_t round = 0; round < 20000; round++)
+    {
+        atomic_size_t ran;
+        atomic_init(&ran, 0);
+        size_t n_tasks = 2 + round % 7;
+        DarrayPool_run(pool, count_task, &ran, n_tasks);
+        assert(atomic_load(&ran) == n_tasks);
+    }
+}
+
+void test_pool(DarrayPool *pool)
+{
+    size_t n = 200003;
+    int64_t *values = Darray_create(int64_t, n);
+    for (size_t i = 0; i < n; i++)
+    {
+        Darray_push(&values, (int64_t)0);
+    }
+
+    Darray_parallel_for(pool, values, square, NULL);
+    for (size_t i = 0; i < n; i++)
+    {
+        assert(values[i] == (int64_t)i * (int64_t)i);
+    }
+
+    int64_t sum = 0;
+    Darray_parallel_reduce(pool, values, &sum, sizeof(sum), sum_chunk,
+                           sum_partial, NULL);
+    int64_t m = (int64_t)n - 1;
+    assert(sum == m * (m + 1) * (2 * m + 1) / 6);
+
+    for (size_t i = 0; i < n; i++)
+    {
+        values[i] = 1;
+    }
+    int64_t zero = 0;
+    Darray_parallel_scan(pool, values, &zero, add);
+    for (size_t i = 0; i < n; i++)
+    {
+        assert(values[i] == (int64_t)i + 1);
+    }
+    Darray_destroy(values);
+
+    uint32_t *keys = Darray_create(uint32_t, 16);
+    uint32_t state = 777;
+    for (size_t i = 0; i < 100000; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        Darray_push(&keys, state % 5000);
+    }
+    uint32_t *expected = Darray_create(uint32_t, 16);
+    Darray_merge(&expected, keys);
+    Darray_sort(expected, DARRAY_U32);
+    Darray_parallel_sort(pool, keys, compare_u32);
+    assert(memcmp(keys, expected, 100000 * sizeof(uint32_t)) == 0);
+    Darray_destroy(expected);
+    Darray_destroy(keys);
+
+    // short arrays stay on the calling thread
+    int64_t *few = Darray_create(int64_t, 4);
+    Darray_push(&few, (int64_t)3);
+    Darray_push(&few, (int64_t)4);
+    Darray_parallel_scan(pool, few, &zero, add);
+    assert(few[0] == 3 && few[1] == 7);
+    Darray_destroy(few);
+
+    // a single chunk never combines anything but the elements
+    for (size_t n = 1; n < 5; n++)
+    {
+        scan_tag = 0x5ca7 + n;
+        Tagged *tagged = Darray_create(Tagged, n);
+        for (size_t i = 0; i < n; i++)
+        {
+            Darray_push(&tagged, ((Tagged){scan_tag, (int64_t)i}));
+        }
+        Tagged identity = {scan_tag, 0};
+        Darray_parallel_scan(pool, tagged, &identity, add_tagged);
+        assert(tagged[n - 1].value == (int64_t)(n * (n - 1) / 2));
+        Darray_destroy(tagged);
+    }
+}
+
+int main()
+{
+    DarrayPool *pool = DarrayPool_create(4);
+    test_pool(pool);
+    test_back_to_back(pool);
+    DarrayPool_destroy(pool);
+
+    // shared pool, one thread per CPU
+    test_pool(NULL);
+
+    printf("parallel tests passed\n");
+    return 0;
+}
@@ -0,0 +1,228 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define SORTED_ARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/SortedArray.c"
+#define COMPRESSED_ARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/CompressedArray.c"
+
+#define BENCH_ELEMENTS (16 << 20)
+#define BENCH_ROUNDS 10
+#define BENCH_LOOKUPS (4 << 20)
+
+static double now()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec + time.tv_nsec * 1e-9;
+}
+
+static void report(const char *name, double seconds, size_t bytes)
+{
+    printf("%-24s %8.2f GB/s\n", name, bytes * BENCH_ROUNDS / seconds / 1e9);
+}
+
+static void report_lookups(const char *name, double seconds)
+{
+    printf("%-24s %8.2f M/s\n", name, BENCH_LOOKUPS / seconds / 1e6);
+}
+
+#define LESS(a, b) ((a) < (b))
+SORTED_ARRAY_DEFINE(Ints, int32_t, LESS)
+
+// hand written loops, what Darray users had to write before
+static size_t scalar_find_i32(int32_t *data, int32_t value)
+{
+    for (size_t i = 0; i < Darray_length(data); i++)
+    {
+        if (data[i] == value)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static size_t scalar_lower_bound_i32(int32_t *data, int32_t value)
+{
+    size_t low = 0;
+    size_t high = Darray_length(data);
+    while (low < high)
+    {
+        size_t middle = low + (high - low) / 2;
+        if (data[middle] < value)
+        {
+            low = middle + 1;
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+static size_t scalar_count_u8(uint8_t *data, uint8_t value)
+{
+    size_t result = 0;
+    for (size_t i = 0; i < Darray_length(data); i++)
+    {
+        result += data[i] == value;
+    }
+    return result;
+}
+
+static float scalar_min_f32(float *data)
+{
+    float result = data[0];
+    for (size_t i = 1; i < Darray_length(data); i++)
+    {
+        if (data[i] < result)
+        {
+            result = data[i];
+        }
+    }
+    return result;
+}
+
+static double scalar_sum_f32(float *data)
+{
+    double result = 0;
+    for (size_t i = 0; i < Darray_length(data); i++)
+    {
+        result += data[i];
+    }
+    return result;
+}
+
+int main()
+{
+    int32_t *ints = Darray_create(int32_t, BENCH_ELEMENTS);
+    uint8_t *bytes = Darray_create(uint8_t, BENCH_ELEMENTS);
+    float *floats = Darray_create(float, BENCH_ELEMENTS);
+    for (size_t i = 0; i < BENCH_ELEMENTS; i++)
+    {
+        Darray_push(&ints, (int32_t)i);
+        Darray_push(&bytes, (uint8_t)(i * 7));
+        Darray_push(&floats, (float)(i % 1000));
+    }
+
+    volatile size_t sink = 0;
+    volatile double fsink = 0;
+    int32_t missing = -1;
+    uint8_t zero = 0;
+    float low;
+    double total;
+    double start;
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        sink += scalar_find_i32(ints, missing);
+    report("scalar find i32", now() - start, BENCH_ELEMENTS * 4);
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        sink += Darray_find(ints, DARRAY_I32, &missing);
+    report("Darray_find i32", now() - start, BENCH_ELEMENTS * 4);
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        sink += scalar_count_u8(bytes, zero);
+    report("scalar count u8", now() - start, BENCH_ELEMENTS);
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        sink += Darray_count(bytes, DARRAY_U8, &zero);
+    report("Darray_count u8", now() - start, BENCH_ELEMENTS);
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        fsink += scalar_min_f32(floats);
+    report("scalar min f32", now() - start, BENCH_ELEMENTS * 4);
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        Darray_min(floats, DARRAY_F32, &low);
+        fsink += low;
+    }
+    report("Darray_min f32", now() - start, BENCH_ELEMENTS * 4);
+
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+        fsink += scalar_sum_f32(floats);
+    report("scalar sum f32", now() - start, BENCH_ELEMENTS * 4);
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        Darray_sum(floats, DARRAY_F32, &total);
+        fsink += total;
+    }
+    report("Darray_sum f32", now() - start, BENCH_ELEMENTS * 4);
+
+    // ints is sorted, keys are spread over it pseudo randomly
+    int32_t *layout = Ints_eytzinger(ints);
+    uint32_t key = 1;
+    start = now();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        key = key * 1103515245 + 12345;
+        sink += scalar_lower_bound_i32(ints, key % BENCH_ELEMENTS);
+    }
+    report_lookups("scalar lower bound", now() - start);
+    start = now();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        key = key * 1103515245 + 12345;
+        sink += Ints_lower_bound(ints, key % BENCH_ELEMENTS);
+    }
+    report_lookups("typed lower bound", now() - start);
+    start = now();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        key = key * 1103515245 + 12345;
+        sink += Ints_eytzinger_lower_bound(layout, key % BENCH_ELEMENTS);
+    }
+    report_lookups("eytzinger lower bound", now() - start);
+    Darray_destroy(layout);
+
+    // sorted ids with small random gaps, decoded throughput counts the
+    // uncompressed bytes written
+    uint64_t *ids = Darray_create(uint64_t, BENCH_ELEMENTS);
+    uint64_t id = 1ull << 40;
+    for (size_t i = 0; i < BENCH_ELEMENTS; i++)
+    {
+        key = key * 1103515245 + 12345;
+        id += (key >> 16) % 1000;
+        Darray_push(&ids, id);
+    }
+    CompressedArray compressed = CompressedArray_from_Darray(ids);
+    printf("%-24s %8.2f x\n", "compression ratio",
+           (double)BENCH_ELEMENTS * 8 / CompressedArray_size(&compressed));
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        memcpy(ids, ids + BENCH_ELEMENTS / 2, BENCH_ELEMENTS / 2 * 8);
+        memcpy(ids + BENCH_ELEMENTS / 2, ids, BENCH_ELEMENTS / 2 * 8);
+    }
+    report("memcpy u64", now() - start, BENCH_ELEMENTS * 8);
+    start = now();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        CompressedArray_decode(&compressed, 0, BENCH_ELEMENTS, ids);
+    }
+    report("compressed decode u64", now() - start, BENCH_ELEMENTS * 8);
+    start = now();
+    for (int i = 0; i < BENCH_LOOKUPS; i++)
+    {
+        key = key * 1103515245 + 12345;
+        sink += CompressedArray_get(&compressed, key % BENCH_ELEMENTS);
+    }
+    report_lookups("compressed get", now() - start);
+    CompressedArray_destroy(&compressed);
+    Darray_destroy(ids);
+
+    Darray_destroy(ints);
+    Darray_destroy(bytes);
+    Darray_destroy(floats);
+}
@@ -1,17 +1,784 @@
+#include <assert.h>
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/resource.h>
 
+#define DARRAY_MAP_THRESHOLD (1 << 20)
 #define DARRAY_INCLUDE_IMPLEMENTATION
 #include "../src/Darray.c"
 
+DARRAY_DEFINE(Floats, float)
+
 void f(void *arg)
 {
     float *value = arg;
     printf("%f", *value);
 }
 
+void test_queue()
+{
+    int *queue = Darray_create(int, 4);
+    int out = 0;
+    for (int i = 0; i < 100000; i++)
+    {
+        Darray_push(&queue, i);
+        if (i % 2 == 1)
+        {
+            Darray_pop_beg(&queue, &out);
+            assert(out == i / 2);
+        }
+    }
+    assert(Darray_length(queue) == 50000);
+    assert(Darray_get_capacity(queue) <= 4 * 50000);
+    for (int i = 0; i < 50000; i++)
+    {
+        assert(queue[i] == 50000 + i);
+    }
+
+    int front[] = {-3, -2, -1};
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push_beg(&queue, &i);
+    }
+    Darray_push_beg_multiple(&queue, front, 3);
+    assert(Darray_length(queue) == 51003);
+    assert(queue[0] == -3 && queue[2] == -1);
+    assert(queue[3] == 999 && queue[1002] == 0 && queue[1003] == 50000);
+
+    int popped[4];
+    Darray_pop_beg_multiple(&queue, popped, 4);
+    assert(popped[0] == -3 && popped[3] == 999);
+    Darray_destroy(queue);
+
+    // smaller elements than the header alignment leave part of a word
+    // between the header and the payload, the header stays aligned
+    unsigned char *bytes = Darray_create(unsigned char, 1);
+    unsigned char first = 0;
+    for (int i = 0; i < 10000; i++)
+    {
+        Darray_push(&bytes, (unsigned char)i);
+        if (i % 3 == 2)
+        {
+            unsigned char c;
+            Darray_pop_beg(&bytes, &c);
+            assert(c == first++);
+        }
+        assert((uintptr_t)GET_SELF((void *)bytes) % DARRAY_HEADER_ALIGNMENT ==
+               0);
+    }
+    for (size_t i = 0; i < Darray_length(bytes); i++)
+    {
+        assert(bytes[i] == (unsigned char)(first + i));
+    }
+    unsigned char marks[] = {1, 2, 3};
+    Darray_push_beg_multiple(&bytes, marks, 3);
+    assert(bytes[0] == 1 && bytes[2] == 3 && bytes[3] == first);
+    Darray_destroy(bytes);
+
+    // a front gap of part of a word out of a small buffer
+    short *shorts = Darray_create_stack(short, 8);
+    for (short i = 0; i < 6; i++)
+    {
+        Darray_push(&shorts, i);
+    }
+    Darray_pop_beg(&shorts, NULL);
+    for (short i = 6; i < 20; i++)
+    {
+        Darray_push(&shorts, i);
+    }
+    for (short i = 0; i < 19; i++)
+    {
+        assert(shorts[i] == i + 1);
+    }
+    Darray_destroy(shorts);
+
+    // and of an aligned array, the next reallocation aligns it again
+    float *aligned = Darray_create_aligned(float, 4, 64);
+    for (int i = 0; i < 3; i++)
+    {
+        Darray_push(&aligned, (float)i);
+    }
+    Darray_pop_beg(&aligned, NULL);
+    for (int i = 3; i < 100; i++)
+    {
+        Darray_push(&aligned, (float)i);
+    }
+    assert((uintptr_t)aligned % 64 == 0);
+    for (int i = 0; i < 99; i++)
+    {
+        assert(aligned[i] == (float)(i + 1));
+    }
+    Darray_destroy(aligned);
+}
+
+void test_typed()
+{
+    float *floats = Floats_create(0);
+    for (int i = 0; i < 1000; i++)
+    {
+        Floats_push(&floats, (float)i);
+    }
+    Floats_insert(&floats, 10, -1.0f);
+    assert(Darray_length(floats) == 1001);
+    assert(Floats_get(floats, 10) == -1.0f && Floats_get(floats, 11) == 10.0f);
+    assert(Floats_remove(&floats, 10) == -1.0f);
+    assert(Floats_pop(&floats) == 999.0f);
+    Floats_set(floats, 0, 0.5f);
+    float out;
+    Darray_pop_beg(&floats, &out);
+    assert(out == 0.5f && floats[0] == 1.0f);
+    assert(Darray_length(floats) == 998);
+    Darray_destroy(floats);
+}
+
+void test_stack()
+{
+    for (int round = 0; round < 4; round++)
+    {
+        size_t *indices = Darray_create_stack(size_t, 16);
+        void *storage = indices;
+        for (size_t i = 0; i < 10; i++)
+        {
+            Darray_push(&indices, i);
+        }
+        assert((void *)indices == storage);
+        Darray_destroy(indices);
+    }
+
+    size_t *indices = Darray_create_stack(size_t, 4);
+    size_t out;
+    Darray_push_beg(&indices, (size_t[]){7});
+    for (size_t i = 0; i < 100; i++)
+    {
+        Darray_push(&indices, i);
+    }
+    Darray_pop_beg(&indices, &out);
+    assert(out == 7 && indices[99] == 99 && Darray_length(indices) == 100);
+    Darray_destroy(indices);
+}
+
+void test_arena()
+{
+    DarrayArena arena = DarrayArena_create(1 << 13);
+    for (int round = 0; round < 3; round++)
+    {
+        int *scratch = Darray_create_arena(int, 4, &arena);
+        void *first = scratch;
+        for (int i = 0; i < 500; i++)
+        {
+            Darray_push(&scratch, i);
+        }
+        // sole allocation of the arena, grows in place
+        assert((void *)scratch == first);
+
+        int *other = Darray_create_arena(int, 4, &arena);
+        for (int i = 0; i < 2000; i++)
+        {
+            Darray_push(&other, i);
+        }
+        int *part = Darray_split(other, 10, 20);
+        assert(Darray_length(part) == 10 && part[0] == 10);
+        assert(scratch[499] == 499 && other[1999] == 1999);
+        DarrayArena_reset(&arena);
+    }
+    DarrayArena_destroy(&arena);
+}
+
+void test_growth()
+{
+    int *arr = Darray_create(int, 8);
+    int reallocs = 0;
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&arr, i);
+    }
+    size_t peak = Darray_get_capacity(arr);
+    int popped[900];
+    Darray_pop_multiple(&arr, popped, 900);
+    assert(Darray_get_capacity(arr) < peak / 2);
+    assert(arr[99] == 99 && popped[899] == 999);
+
+    // oscillating around a boundary does not resize every time
+    size_t capacity = Darray_get_capacity(arr);
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&arr, i);
+        Darray_pop(&arr, NULL);
+        reallocs += Darray_get_capacity(arr) != capacity;
+        capacity = Darray_get_capacity(arr);
+    }
+    assert(reallocs == 0);
+
+    Darray_pop_middle(&arr, 10, popped);
+    assert(popped[0] == 10 && arr[10] == 11);
+    Darray_shrink_to_fit(&arr);
+    assert(Darray_get_capacity(arr) == Darray_length(arr));
+
+    Darray_set_growth(arr, DARRAY_GROWTH_FIXED, 100);
+    Darray_push(&arr, 1);
+    assert(Darray_get_capacity(arr) == 199);
+    Darray_set_growth(arr, DARRAY_GROWTH_PAGE, 0);
+    Darray_push_multiple(&arr, popped, 200);
+    assert((Darray_get_capacity(arr) * sizeof(int) + sizeof(Darray)) % 4096 ==
+           0);
+    Darray_destroy(arr);
+}
+
+void test_large()
+{
+    size_t *large = Darray_create(size_t, 16);
+    Darray_set_options(large,
+                       DARRAY_OPTION_HUGE_PAGES | DARRAY_OPTION_PREFAULT);
+    for (size_t i = 0; i < 1000000; i++)
+    {
+        Darray_push(&large, i);
+    }
+#ifdef DARRAY_MAP
+    assert((GET_SELF((void *)large))->flags & DARRAY_FLAG_MAPPED);
+#endif
+    Darray_reserve(&large, 3000000);
+    assert(Darray_get_capacity(large) == 3000000);
+    Darray_pop_beg_multiple(&large, NULL, 10);
+    Darray_pop_multiple(&large, NULL, 900000);
+    assert(Darray_length(large) == 99990);
+    assert(large[0] == 10 && large[99989] == 99999);
+    Darray_destroy(large);
+
+#ifdef DARRAY_MAP
+    // reserving inside the capacity faults the reserved space in as well
+    char *touched = Darray_create(char, 16);
+    Darray_reserve(&touched, 8 << 20);
+    Darray_set_options(touched, DARRAY_OPTION_PREFAULT);
+    Darray_reserve(&touched, 4 << 20);
+    char page[4096] = {0};
+    struct rusage before, after;
+    getrusage(RUSAGE_SELF, &before);
+    for (int i = 0; i < 1024; i++)
+    {
+        Darray_push_multiple(&touched, page, sizeof(page));
+    }
+    getrusage(RUSAGE_SELF, &after);
+    // one fault per page without, sanitizer shadow memory can add some
+    assert(after.ru_minflt - before.ru_minflt < 512);
+    Darray_destroy(touched);
+#endif
+
+    // a shrink of an unmapped array that still ends above the threshold
+    int *shrunk = Darray_create(int, 1 << 20);
+    for (int i = 0; i < 1000000; i++)
+    {
+        Darray_push(&shrunk, i);
+    }
+    Darray_reserve(&shrunk, 1);
+    Darray_pop_multiple(&shrunk, NULL, 740000);
+#ifdef DARRAY_MAP
+    assert((GET_SELF((void *)shrunk))->flags & DARRAY_FLAG_MAPPED);
+#endif
+    assert(Darray_length(shrunk) == 260000);
+    for (int i = 0; i < 260000; i++)
+    {
+        assert(shrunk[i] == i);
+    }
+    Darray_destroy(shrunk);
+}
+
+void test_search()
+{
+    int16_t *shorts = Darray_create(int16_t, 16);
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&shorts, (int16_t)(i % 300 - 100));
+    }
+    int16_t value = 150, extreme;
+    int64_t sum;
+    assert(Darray_find(shorts, DARRAY_I16, &value) == 250);
+    assert(Darray_count(shorts, DARRAY_I16, &value) == 3);
+    value = 500;
+    assert(!Darray_contains(shorts, DARRAY_I16, &value));
+    Darray_min(shorts, DARRAY_I16, &extreme);
+    assert(extreme == -100);
+    Darray_max(shorts, DARRAY_I16, &extreme);
+    assert(extreme == 199);
+    Darray_sum(shorts, DARRAY_I16, &sum);
+    assert(sum == 3 * 14850 + 4950 - 10000);
+    Darray_destroy(shorts);
+
+    uint8_t *bytes = Darray_create(uint8_t, 16);
+    for (int i = 0; i < 100000; i++)
+    {
+        Darray_push(&bytes, (uint8_t)(i * 7));
+    }
+    uint8_t byte = 0;
+    assert(Darray_count(bytes, DARRAY_U8, &byte) == 391);
+    Darray_pop_multiple(&bytes, NULL, 100000);
+    assert(!Darray_max(bytes, DARRAY_U8, &byte));
+    Darray_destroy(bytes);
+
+    float *floats = Darray_create(float, 16);
+    for (int i = 0; i < 100; i++)
+    {
+        Darray_push(&floats, (float)(i - 50));
+    }
+    float low, high;
+    double total;
+    Darray_min(floats, DARRAY_F32, &low);
+    Darray_max(floats, DARRAY_F32, &high);
+    Darray_sum(floats, DARRAY_F32, &total);
+    assert(low == -50.0f && high == 49.0f && total == -50.0);
+    Darray_destroy(floats);
+}
+
+typedef struct Pair
+{
+    int64_t key;
+    int64_t payload;
+    char name[8];
+} Pair;
+
+int compare_pairs(const void *a, const void *b)
+{
+    const Pair *left = a, *right = b;
+    return (left->key > right->key) - (left->key < right->key);
+}
+
+int compare_ints(const void *a, const void *b)
+{
+    int left = *(const int *)a, right = *(const int *)b;
+    return (left > right) - (left < right);
+}
+
+void test_sort()
+{
+    int32_t *ints = Darray_create(int32_t, 16);
+    uint32_t state = 12345;
+    for (int i = 0; i < 50000; i++)
+    {
+        state = state * 1664525u + 1013904223u;
+        Darray_push(&ints, (int32_t)state);
+    }
+    Darray_sort(ints, DARRAY_I32);
+    for (size_t i = 1; i < Darray_length(ints); i++)
+    {
+        assert(ints[i - 1] <= ints[i]);
+    }
+    Darray_destroy(ints);
+
+    double *doubles = Darray_create(double, 16);
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&doubles, (double)((i * 37) % 1000 - 500) / 4.0);
+    }
+    Darray_sort(doubles, DARRAY_F64);
+    for (int i = 0; i < 1000; i++)
+    {
+        assert(doubles[i] == (double)(i - 500) / 4.0);
+    }
+    Darray_destroy(doubles);
+
+    // sorted, reversed, organ pipe and constant inputs for the comparison sort
+    int *patterns = Darray_create(int, 16);
+    for (int pattern = 0; pattern < 4; pattern++)
+    {
+        Darray_pop_multiple(&patterns, NULL, Darray_length(patterns));
+        for (int i = 0; i < 10000; i++)
+        {
+            int values[] = {i, 10000 - i, i < 5000 ? i : 10000 - i, 7};
+            Darray_push(&patterns, values[pattern]);
+        }
+        Darray_sort_compare(patterns, compare_ints);
+        for (size_t i = 1; i < Darray_length(patterns); i++)
+        {
+            assert(patterns[i - 1] <= patterns[i]);
+        }
+    }
+    Darray_destroy(patterns);
+
+    Pair *pairs = Darray_create(Pair, 16);
+    for (int i = 0; i < 3000; i++)
+    {
+        Pair pair = {.key = (i * 7919) % 3000, .payload = i};
+        Darray_push(&pairs, pair);
+    }
+    Darray_sort_compare(pairs, compare_pairs);
+    for (int i = 0; i < 3000; i++)
+    {
+        assert(pairs[i].key == i && (pairs[i].payload * 7919) % 3000 == i);
+    }
+    Darray_destroy(pairs);
+}
+
+bool is_odd(const void *element, void *context)
+{
+    return *(const int *)element % 2 != 0;
+}
+
+bool below(const void *element, void *context)
+{
+    return *(const int *)element < *(int *)context;
+}
+
+void test_remove()
+{
+    int *numbers = Darray_create(int, 16);
+    for (int i = 0; i < 10000; i++)
+    {
+        Darray_push(&numbers, i);
+    }
+    assert(Darray_remove_if(&numbers, is_odd, NULL) == 5000);
+    assert(Darray_length(numbers) == 5000);
+    for (int i = 0; i < 5000; i++)
+    {
+        assert(numbers[i] == 2 * i);
+    }
+    // removing most of the array gives memory back in one step
+    int limit = 100;
+    assert(Darray_retain(&numbers, below, &limit) == 4950);
+    assert(Darray_length(numbers) == 50 && numbers[49] == 98);
+    assert(Darray_get_capacity(numbers) < 5000);
+
+    size_t indices[] = {0, 1, 2, 10, 48, 49};
+    assert(Darray_remove_indices(&numbers, indices, 6) == 6);
+    assert(Darray_length(numbers) == 44);
+    assert(numbers[0] == 6 && numbers[6] == 18 && numbers[7] == 22);
+    assert(numbers[43] == 94);
+
+    int out;
+    Darray_swap_remove(&numbers, 0, &out);
+    assert(out == 6 && numbers[0] == 94 && Darray_length(numbers) == 43);
+    Darray_swap_remove(&numbers, 42, &out);
+    assert(out == 92 && Darray_length(numbers) == 42);
+    Darray_destroy(numbers);
+}
+
+void test_insert_batch()
+{
+    int *numbers = Darray_create(int, 4);
+    for (int i = 0; i < 10; i++)
+    {
+        Darray_push(&numbers, 10 * i);
+    }
+    size_t indices[] = {0, 3, 3, 10};
+    int values[] = {-5, 25, 27, 95};
+    Darray_insert_batch(&numbers, indices, values, 4);
+    int expected[] = {-5, 0, 10, 20, 25, 27, 30, 40, 50, 60, 70, 80, 90, 95};
+    assert(Darray_length(numbers) == 14);
+    assert(memcmp(numbers, expected, sizeof(expected)) == 0);
+
+    // merging a sorted delta into a sorted array
+    int *sorted = Darray_create(int, 16);
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&sorted, 2 * i);
+    }
+    size_t positions[500];
+    int odd[500];
+    for (int j = 0; j < 500; j++)
+    {
+        odd[j] = 4 * j + 1;
+        positions[j] = 2 * j + 1;
+    }
+    Darray_insert_batch(&sorted, positions, odd, 500);
+    assert(Darray_length(sorted) == 1500);
+    for (int i = 1; i < 1500; i++)
+    {
+        assert(sorted[i - 1] < sorted[i]);
+    }
+    Darray_destroy(sorted);
+    Darray_destroy(numbers);
+}
+
+void test_file()
+{
+    const char *path = "/tmp/Darray_test_file";
+    uint64_t *ids = Darray_create_file(uint64_t, 16, path);
+    if (ids == NULL)
+    {
+        printf("persistent arrays are not supported, skipping\n");
+        return;
+    }
+    for (uint64_t i = 0; i < 200000; i++)
+    {
+        Darray_push(&ids, i * 3);
+    }
+    Darray_pop_beg_multiple(&ids, NULL, 10);
+    Darray_destroy(ids);
+
+    assert(Darray_open_file(uint32_t, path) == NULL);
+    ids = Darray_open_file(uint64_t, path);
+    assert(ids != NULL && Darray_length(ids) == 199990);
+    assert(ids[0] == 30 && ids[199989] == 599997);
+    Darray_push(&ids, (uint64_t)7);
+    Darray_sort(ids, DARRAY_U64);
+    assert(Darray_sync(&ids));
+    Darray_destroy(ids);
+
+    ids = Darray_open_file(uint64_t, path);
+    assert(Darray_length(ids) == 199991 && ids[0] == 7 && ids[1] == 30);
+    Darray_pop_multiple(&ids, NULL, 199990);
+    Darray_destroy(ids);
+    ids = Darray_open_file(uint64_t, path);
+    assert(Darray_length(ids) == 1 && Darray_get_capacity(ids) == 16);
+    Darray_destroy(ids);
+    remove(path);
+}
+
+void test_slice()
+{
+    int32_t *numbers = Darray_create(int32_t, 16);
+    for (int32_t i = 0; i < 1000; i++)
+    {
+        Darray_push(&numbers, i);
+    }
+    DarraySlice slice = Darray_slice(numbers, 100, 200);
+    assert(slice.length == 100 && *(int32_t *)DarraySlice_get(slice, 0) == 100);
+    int32_t value = 150, extreme;
+    assert(DarraySlice_find(slice, DARRAY_I32, &value) == 50);
+    value = 250;
+    assert(!DarraySlice_contains(slice, DARRAY_I32, &value));
+    DarraySlice_max(slice, DARRAY_I32, &extreme);
+    assert(extreme == 199);
+
+    DarraySlice inner = DarraySlice_slice(slice, 10, 20);
+    int64_t sum = 0, total;
+    DarraySlice_for_each(inner, int32_t, element)
+    {
+        sum += *element;
+    }
+    DarraySlice_sum(inner, DARRAY_I32, &total);
+    assert(sum == 1145 && total == 1145);
+    DarraySlice empty = DarraySlice_slice(inner, 5, 5);
+    assert(!DarraySlice_min(empty, DARRAY_I32, &extreme));
+
+    int32_t *copy = DarraySlice_to_Darray(inner);
+    int32_t *split = Darray_split_copy(numbers, 110, 120);
+    assert(Darray_length(copy) == 10 && Darray_length(split) == 10);
+    assert(memcmp(copy, split, 10 * sizeof(int32_t)) == 0);
+    Darray_destroy(copy);
+    Darray_destroy(split);
+    Darray_destroy(numbers);
+}
+
+// hands out blocks at 16 and 48 bytes past a multiple of 64 in turn, so that
+// every reallocation changes the padding of an aligned array
+int shifting_offset = 16;
+
+void *shifting_malloc(size_t size)
+{
+    char *raw = malloc(size + 128);
+    uintptr_t base = ((uintptr_t)raw + 16 + 63) / 64 * 64;
+    char *block = (char *)(base + shifting_offset);
+    shifting_offset = shifting_offset == 16 ? 48 : 16;
+    memcpy(block - 16, &raw, sizeof(raw));
+    memcpy(block - 8, &size, sizeof(size));
+    return block;
+}
+
+void shifting_free(void *block)
+{
+    char *raw;
+    memcpy(&raw, (char *)block - 16, sizeof(raw));
+    free(raw);
+}
+
+void *shifting_realloc(void *block, size_t size)
+{
+    size_t old_size;
+    memcpy(&old_size, (char *)block - 8, sizeof(old_size));
+    void *moved = shifting_malloc(size);
+    memcpy(moved, block, old_size < size ? old_size : size);
+    shifting_free(block);
+    return moved;
+}
+
+void test_aligned()
+{
+    size_t alignments[] = {32, 64};
+    for (int a = 0; a < 2; a++)
+    {
+        float *values = Darray_create_aligned(float, 3, alignments[a]);
+        assert((uintptr_t)values % alignments[a] == 0);
+        // grows through realloc and into a mapping past the threshold
+        for (int i = 0; i < 400000; i++)
+        {
+            Darray_push(&values, (float)i);
+            assert((uintptr_t)values % alignments[a] == 0);
+        }
+        assert(values[399999] == 399999.0f);
+        Darray_pop_multiple(&values, NULL, 399990);
+        assert((uintptr_t)values % alignments[a] == 0);
+        assert(Darray_length(values) == 10 && values[9] == 9.0f);
+        Darray_destroy(values);
+    }
+
+    // a queue loses the alignment, the next reallocation restores it
+    double *queue = Darray_create_aligned(double, 4, 64);
+    Darray_push(&queue, 1.0);
+    Darray_push(&queue, 2.0);
+    Darray_pop_beg(&queue, NULL);
+    Darray_shrink_to_fit(&queue);
+    assert((uintptr_t)queue % 64 == 0 && queue[0] == 2.0);
+    Darray_destroy(queue);
+
+    // growing and shrinking move the block to a new padding every time
+    double *shifted = _Darray_create_aligned(sizeof(double), 4, 64,
+                                             shifting_malloc,
+                                             shifting_realloc, shifting_free);
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&shifted, (double)i);
+        assert((uintptr_t)shifted % 64 == 0);
+    }
+    Darray_pop_multiple(&shifted, NULL, 990);
+    assert((uintptr_t)shifted % 64 == 0);
+    assert(Darray_length(shifted) == 10);
+    for (int i = 0; i < 10; i++)
+    {
+        assert(shifted[i] == (double)i);
+    }
+    Darray_destroy(shifted);
+}
+
+void test_cache()
+{
+    Darray_cache_set_budget(1 << 16);
+    // 100 ints and the header round up to a 512 byte block
+    int *first = Darray_create(int, 100);
+    assert(Darray_get_capacity(first) == (512 - sizeof(Darray)) / sizeof(int));
+    Darray_destroy(first);
+    assert(Darray_cache_get_size() == 512);
+    int *second = Darray_create(int, 90);
+    assert(second == first && Darray_cache_get_size() == 0);
+
+    // growth hands the old block to the cache and takes a cached one
+    int *other = Darray_create(int, 200);
+    Darray_destroy(other);
+    for (int i = 0; i < 200; i++)
+    {
+        Darray_push(&second, i);
+    }
+    assert(second == other && Darray_cache_get_size() == 512);
+    for (int i = 0; i < 200; i++)
+    {
+        assert(second[i] == i);
+    }
+    Darray_destroy(second);
+    assert(Darray_cache_get_size() == 512 + 1024);
+
+    // over budget blocks are freed, foreign allocators never enter
+    double *big = Darray_create(double, 1 << 14);
+    Darray_destroy(big);
+    assert(Darray_cache_get_size() == 512 + 1024);
+    float *aligned = Darray_create_aligned(float, 8, 64);
+    Darray_destroy(aligned);
+    assert(Darray_cache_get_size() == 512 + 1024);
+
+    Darray_cache_trim(600);
+    assert(Darray_cache_get_size() == 512);
+    Darray_cache_set_budget(0);
+    assert(Darray_cache_get_size() == 0);
+    int *plain = Darray_create(int, 100);
+    assert(Darray_get_capacity(plain) == 100);
+    Darray_destroy(plain);
+    assert(Darray_cache_get_size() == 0);
+
+    // a shrink into a smaller cached block copies only what is left
+    Darray_cache_set_budget(1 << 20);
+    int *shrinking = Darray_create(int, 4);
+    for (int i = 0; i < 1000; i++)
+    {
+        Darray_push(&shrinking, i);
+    }
+    int *small = Darray_create(int, 30);
+    Darray_destroy(small);
+    Darray_pop_multiple(&shrinking, NULL, 990);
+    assert(shrinking == small && Darray_length(shrinking) == 10);
+    for (int i = 0; i < 10; i++)
+    {
+        assert(shrinking[i] == i);
+    }
+    Darray_destroy(shrinking);
+    Darray_cache_set_budget(0);
+}
+
+#ifdef DARRAY_STATS
+void test_stats()
+{
+    int *ints = Darray_create(int, 2);
+    int line = __LINE__ - 1;
+    DarrayStats stats = Darray_get_stats(ints);
+    assert(stats.site->line == line && stats.n_reallocs == 0);
+    for (int i = 0; i < 100; i++)
+    {
+        Darray_push(&ints, i);
+    }
+    Darray_push_middle(&ints, 0, -1);
+    Darray_pop_middle(&ints, 0, NULL);
+    stats = Darray_get_stats(ints);
+    assert(stats.n_reallocs == 6 && stats.peak_length == 101);
+    assert(stats.peak_capacity == 128);
+    assert(stats.bytes_moved == 2 * 100 * sizeof(int));
+
+    // typed fast paths are counted too
+    float *floats = Floats_create(4);
+    Floats_push(&floats, 1.0f);
+    Floats_push(&floats, 2.0f);
+    Floats_insert(&floats, 0, 0.5f);
+    stats = Darray_get_stats(floats);
+    assert(stats.peak_length == 3 && stats.bytes_moved == 2 * sizeof(float));
+    assert(strcmp(stats.site->file, "(untracked)") == 0);
+    Darray_destroy(floats);
+
+    DarrayArena arena = DarrayArena_create(1024);
+    int *scratch = Darray_create_arena(int, 4, &arena);
+    assert(Darray_get_stats(scratch).site == NULL);
+    DarrayArena_destroy(&arena);
+
+    char location[64];
+    snprintf(location, sizeof(location), "%s:%d", __FILE__, line);
+    char buffer[4096] = {0};
+    FILE *stream = fmemopen(buffer, sizeof(buffer) - 1, "w");
+    Darray_stats_dump(stream);
+    fclose(stream);
+    // the site shows the live array, then the destroyed one
+    char *row = strstr(buffer, location);
+    assert(row != NULL);
+    size_t n_arrays, n_live, n_reallocs;
+    sscanf(row + strlen(location), "%zu %zu %zu", &n_arrays, &n_live,
+           &n_reallocs);
+    assert(n_arrays == 1 && n_live == 1 && n_reallocs == 6);
+    Darray_destroy(ints);
+
+    memset(buffer, 0, sizeof(buffer));
+    stream = fmemopen(buffer, sizeof(buffer) - 1, "w");
+    Darray_stats_dump(stream);
+    fclose(stream);
+    row = strstr(buffer, location);
+    sscanf(row + strlen(location), "%zu %zu %zu", &n_arrays, &n_live,
+           &n_reallocs);
+    assert(n_arrays == 1 && n_live == 0 && n_reallocs == 6);
+}
+#endif
+
 int main()
 {
+    test_queue();
+    test_typed();
+    test_stack();
+    test_arena();
+    test_growth();
+    test_large();
+    test_search();
+    test_sort();
+    test_remove();
+    test_insert_batch();
+    test_file();
+    test_slice();
+    test_aligned();
+    test_cache();
+#ifdef DARRAY_STATS
+    test_stats();
+#endif
+
     float *arr = Darray_create(float, 3);
 
     float eee[] = {1.0f, 23.5f, 56.9f, 45.7f, 44.5f, 3.33f, 67.0f};
@@ -25,4 +792,5 @@ int main()
     Darray_pop_middle(&arr, 4, NULL);
 
     Darray_print(arr, NULL, f);
+    Darray_destroy(arr);
 }
@@ -0,0 +1,40 @@
+#include <assert.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define GAP_BUFFER_INCLUDE_IMPLEMENTATION
+#include "../src/GapBuffer.c"
+
+void print_char(void *arg)
+{
+    printf("%c", *(char *)arg);
+}
+
+int main()
+{
+    GapBuffer buffer = GapBuffer_create(char, 4);
+
+    GapBuffer_push_multiple(&buffer, "hello world", 11);
+    GapBuffer_move_cursor(&buffer, 5);
+    GapBuffer_push(&buffer, ',');
+    GapBuffer_pop_forward(&buffer, NULL);
+    GapBuffer_push_multiple(&buffer, " big ", 5);
+    assert(GapBuffer_get_cursor(&buffer) == 11);
+
+    char popped[4];
+    GapBuffer_pop_multiple(&buffer, popped, 4);
+    assert(popped[0] == 'b' && popped[3] == ' ');
+    GapBuffer_push_at(&buffer, 0, '>');
+    GapBuffer_pop_at(&buffer, 1, NULL);
+    assert(*(char *)GapBuffer_get(&buffer, 0) == '>');
+    assert(*(char *)GapBuffer_get(&buffer, 6) == ' ');
+
+    char *flat = GapBuffer_to_Darray(&buffer);
+    assert(Darray_length(flat) == GapBuffer_length(&buffer));
+    assert(memcmp(flat, ">ello, world", 12) == 0);
+    Darray_print(flat, NULL, print_char);
+
+    Darray_destroy(flat);
+    GapBuffer_destroy(&buffer);
+}
@@ -0,0 +1,109 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define PRIORITY_QUEUE_INCLUDE_IMPLEMENTATION
+#include "../src/PriorityQueue.c"
+
+typedef struct Task
+{
+    int64_t deadline;
+    int32_t id;
+} Task;
+
+int compare_ints(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int compare_tasks(const void *a, const void *b)
+{
+    int64_t x = ((const Task *)a)->deadline;
+    int64_t y = ((const Task *)b)->deadline;
+    return (x > y) - (x < y);
+}
+
+// pops everything and checks it comes out in order
+void drain(PriorityQueue *queue, size_t expected)
+{
+    int32_t previous = INT32_MIN;
+    for (size_t i = 0; i < expected; i++)
+    {
+        int32_t value;
+        assert(*(int32_t *)PriorityQueue_top(queue) >= previous);
+        PriorityQueue_pop(queue, &value);
+        assert(value >= previous);
+        previous = value;
+    }
+    assert(PriorityQueue_length(queue) == 0);
+    assert(PriorityQueue_top(queue) == NULL);
+}
+
+int main()
+{
+    for (size_t arity = 2; arity <= 8; arity *= 2)
+    {
+        PriorityQueue queue = PriorityQueue_create(int32_t, 4, arity,
+                                                   compare_ints);
+        uint32_t state = 7;
+        for (int i = 0; i < 5000; i++)
+        {
+            state = state * 1103515245 + 12345;
+            PriorityQueue_push(&queue, (int32_t)((state >> 16) % 1000));
+        }
+        assert(PriorityQueue_length(&queue) == 5000);
+        drain(&queue, 5000);
+        PriorityQueue_destroy(&queue);
+
+        int32_t *data = Darray_create(int32_t, 16);
+        for (int32_t i = 0; i < 3001; i++)
+        {
+            Darray_push(&data, (i * 7919) % 3001);
+        }
+        queue = PriorityQueue_from_Darray(data, arity, compare_ints);
+        assert(*(int32_t *)PriorityQueue_top(&queue) == 0);
+        // handles are the indices in the original array
+        assert(*(int32_t *)PriorityQueue_get(&queue, 5) == 5 * 7919 % 3001);
+        drain(&queue, 3001);
+        PriorityQueue_destroy(&queue);
+    }
+
+    // scheduler style use, deadlines move earlier while tasks wait
+    PriorityQueue tasks = PriorityQueue_create(Task, 8, 4, compare_tasks);
+    size_t handles[100];
+    for (int32_t i = 0; i < 100; i++)
+    {
+        Task task = {.deadline = 1000 + i, .id = i};
+        handles[i] = _PriorityQueue_push(&tasks, &task);
+        assert(handles[i] == (size_t)i);
+    }
+    for (int32_t i = 0; i < 100; i += 10)
+    {
+        Task task = {.deadline = 500 - i, .id = i};
+        PriorityQueue_decrease_key(&tasks, handles[i], &task);
+        assert(((Task *)PriorityQueue_get(&tasks, handles[i]))->id == i);
+    }
+    Task first;
+    PriorityQueue_pop(&tasks, &first);
+    assert(first.id == 90 && first.deadline == 410);
+
+    // the popped handle is the next one handed out
+    Task late = {.deadline = 5000, .id = 100};
+    assert(_PriorityQueue_push(&tasks, &late) == handles[90]);
+    for (int32_t i = 80; i >= 0; i -= 10)
+    {
+        PriorityQueue_pop(&tasks, &first);
+        assert(first.id == i);
+    }
+    PriorityQueue_pop(&tasks, &first);
+    assert(first.id == 1 && first.deadline == 1001);
+    assert(PriorityQueue_length(&tasks) == 90);
+    PriorityQueue_destroy(&tasks);
+
+    printf("priority queue tests passed\n");
+    return 0;
+}
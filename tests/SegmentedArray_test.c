@@ -0,0 +1,69 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define SEGMENTED_ARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/SegmentedArray.c"
+
+void sum_segment(void *segment, size_t n, void *context)
+{
+    int64_t *values = segment;
+    for (size_t i = 0; i < n; i++)
+    {
+        *(int64_t *)context += values[i];
+    }
+}
+
+int main()
+{
+    SegmentedArray array = SegmentedArray_create(int64_t, 5);
+    assert(SegmentedArray_get_capacity(&array) == 0);
+
+    SegmentedArray_push(&array, (int64_t)0);
+    int64_t *first = SegmentedArray_get(&array, 0);
+    for (int64_t i = 1; i < 100000; i++)
+    {
+        SegmentedArray_push(&array, i);
+    }
+    // growth never moved the first element
+    assert(first == SegmentedArray_get(&array, 0) && *first == 0);
+    for (size_t i = 0; i < 100000; i++)
+    {
+        assert(*(int64_t *)SegmentedArray_get(&array, i) == (int64_t)i);
+    }
+    assert(array.n_segments == 14);
+
+    int64_t more[1000];
+    for (int i = 0; i < 1000; i++)
+    {
+        more[i] = 100000 + i;
+    }
+    SegmentedArray_push_multiple(&array, more, 1000);
+    assert(SegmentedArray_length(&array) == 101000);
+    assert(*(int64_t *)SegmentedArray_get(&array, 100999) == 100999);
+
+    int64_t sum = 0;
+    SegmentedArray_for_each_segment(&array, sum_segment, &sum);
+    assert(sum == (int64_t)101000 * 100999 / 2);
+
+    int64_t *flat = SegmentedArray_to_Darray(&array);
+    assert(Darray_length(flat) == 101000 && flat[54321] == 54321);
+    Darray_destroy(flat);
+
+    int64_t popped[3];
+    SegmentedArray_pop_multiple(&array, popped, 3);
+    assert(popped[0] == 100997 && popped[2] == 100999);
+    SegmentedArray_pop_multiple(&array, NULL, 100990);
+    SegmentedArray_shrink_to_fit(&array);
+    assert(SegmentedArray_length(&array) == 7);
+    assert(SegmentedArray_get_capacity(&array) == 8);
+    SegmentedArray_reserve(&array, 100);
+    assert(SegmentedArray_get_capacity(&array) >= 100);
+    assert(first == SegmentedArray_get(&array, 0));
+
+    SegmentedArray_destroy(&array);
+    printf("segmented array tests passed\n");
+    return 0;
+}
@@ -0,0 +1,132 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define SORTED_ARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/SortedArray.c"
+
+#define LESS(a, b) ((a) < (b))
+SORTED_ARRAY_DEFINE(Ints, int32_t, LESS)
+
+typedef struct Entry
+{
+    int32_t key;
+    int32_t order;
+} Entry;
+
+int compare_ints(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+    return (x > y) - (x < y);
+}
+
+int compare_entries(const void *a, const void *b)
+{
+    return compare_ints(&((const Entry *)a)->key, &((const Entry *)b)->key);
+}
+
+// the reference every search is checked against
+size_t linear_bound(int32_t *data, int32_t key, bool upper)
+{
+    size_t i = 0;
+    while (i < Darray_length(data) &&
+           (data[i] < key || (upper && data[i] == key)))
+    {
+        i++;
+    }
+    return i;
+}
+
+void check_searches(int32_t *data)
+{
+    size_t n = Darray_length(data);
+    int32_t *layout = Ints_eytzinger(data);
+    assert(Darray_length(layout) == n + 1);
+    assert((uintptr_t)layout % SORTED_ARRAY_CACHE_LINE == 0);
+
+    int32_t highest = n ? data[n - 1] + 2 : 2;
+    for (int32_t key = -2; key <= highest; key++)
+    {
+        size_t lower = linear_bound(data, key, false);
+        size_t upper = linear_bound(data, key, true);
+        assert(Darray_lower_bound(data, &key, compare_ints) == lower);
+        assert(Darray_upper_bound(data, &key, compare_ints) == upper);
+        assert(Ints_lower_bound(data, key) == lower);
+        assert(Ints_upper_bound(data, key) == upper);
+
+        DarraySlice equal = Darray_equal_range(data, &key, compare_ints);
+        assert(equal.data == data + lower && equal.length == upper - lower);
+        equal = Ints_equal_range(data, key);
+        assert(equal.data == data + lower && equal.length == upper - lower);
+
+        // a layout slot holds the same value as the sorted index
+        size_t slot = Darray_eytzinger_lower_bound(layout, &key, compare_ints);
+        assert(slot == Ints_eytzinger_lower_bound(layout, key));
+        assert(lower == n ? slot == 0 : layout[slot] == data[lower]);
+        slot = Darray_eytzinger_upper_bound(layout, &key, compare_ints);
+        assert(slot == Ints_eytzinger_upper_bound(layout, key));
+        assert(upper == n ? slot == 0 : layout[slot] == data[upper]);
+    }
+    Darray_destroy(layout);
+}
+
+int main()
+{
+    // every length up to a few complete tree levels, with duplicates
+    for (size_t n = 0; n < 70; n++)
+    {
+        int32_t *data = Darray_create(int32_t, n + 1);
+        for (size_t i = 0; i < n; i++)
+        {
+            Darray_push(&data, (int32_t)(i / 3 * 2));
+        }
+        check_searches(data);
+        Darray_destroy(data);
+    }
+
+    int32_t *ints = Darray_create(int32_t, 4);
+    uint32_t state = 1;
+    for (int i = 0; i < 2000; i++)
+    {
+        state = state * 1103515245 + 12345;
+        int32_t value = (state >> 16) % 500;
+        size_t index = Ints_insert(&ints, value);
+        assert(ints[index] == value);
+    }
+    assert(Darray_length(ints) == 2000);
+    for (size_t i = 1; i < 2000; i++)
+    {
+        assert(ints[i - 1] <= ints[i]);
+    }
+    check_searches(ints);
+    Darray_destroy(ints);
+
+    // equal keys keep their insertion order
+    Entry *entries = Darray_create(Entry, 4);
+    for (int32_t i = 0; i < 300; i++)
+    {
+        Entry entry = {.key = (i * 7) % 10, .order = i};
+        size_t index = _Darray_insert_sorted((void **)&entries, &entry,
+                                             compare_entries);
+        assert(entries[index].order == i);
+    }
+    Darray_insert_sorted(&entries, ((Entry){.key = 4, .order = 300}),
+                         compare_entries);
+    Entry key = {.key = 4};
+    DarraySlice fours = Darray_equal_range(entries, &key, compare_entries);
+    assert(fours.length == 31);
+    int32_t last = -1;
+    DarraySlice_for_each(fours, Entry, entry)
+    {
+        assert(entry->key == 4 && entry->order > last);
+        last = entry->order;
+    }
+    assert(last == 300);
+    Darray_destroy(entries);
+
+    printf("sorted array tests passed\n");
+    return 0;
+}
@@ -0,0 +1,99 @@
+#include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#define STRING_BUILDER_INCLUDE_IMPLEMENTATION
+#include "../src/StringBuilder.c"
+
+// the builder has to match printf digit for digit
+void check_float(double value, int precision)
+{
+    char expected[512];
+    snprintf(expected, sizeof(expected), "%.*f", precision, value);
+    char *builder = StringBuilder_create(0);
+    StringBuilder_append_float(&builder, value, precision);
+    assert(strcmp(builder, expected) == 0);
+    assert(Darray_length(builder) == strlen(expected));
+    Darray_destroy(builder);
+}
+
+int main()
+{
+    char *builder = StringBuilder_create(1);
+    assert(Darray_length(builder) == 0 && builder[0] == 0);
+
+    StringBuilder_append(&builder, "gcc");
+    StringBuilder_append_char(&builder, ' ');
+    StringBuilder_append_n(&builder, "-O2 -Wall", 3);
+    assert(strcmp(builder, "gcc -O2") == 0);
+    assert(Darray_length(builder) == 7);
+
+    // small enough to print in place, then too big for the spare capacity
+    StringBuilder_append_format(&builder, " -o %s", "a.out");
+    assert(strcmp(builder, "gcc -O2 -o a.out") == 0);
+    char long_name[300];
+    memset(long_name, 'x', sizeof(long_name) - 1);
+    long_name[sizeof(long_name) - 1] = 0;
+    StringBuilder_append_format(&builder, " %s.c %d", long_name, 12);
+    assert(Darray_length(builder) == 16 + 1 + 299 + 2 + 3);
+    assert(strncmp(builder + 17, long_name, 299) == 0);
+    assert(strcmp(builder + 17 + 299, ".c 12") == 0);
+
+    // reset keeps the capacity for the next string
+    size_t capacity = Darray_get_capacity(builder);
+    StringBuilder_reset(builder);
+    assert(Darray_length(builder) == 0 && builder[0] == 0);
+    assert(Darray_get_capacity(builder) == capacity);
+
+    int64_t ints[] = {0, 1, -1, 9, 10, 99, 100, -101, 123456789, INT64_MAX,
+                      INT64_MIN};
+    char expected[64];
+    for (size_t i = 0; i < sizeof(ints) / sizeof(*ints); i++)
+    {
+        StringBuilder_reset(builder);
+        StringBuilder_append_int(&builder, ints[i]);
+        snprintf(expected, sizeof(expected), "%lld", (long long)ints[i]);
+        assert(strcmp(builder, expected) == 0);
+    }
+    StringBuilder_reset(builder);
+    StringBuilder_append_uint(&builder, UINT64_MAX);
+    assert(strcmp(builder, "18446744073709551615") == 0);
+    Darray_destroy(builder);
+
+    double floats[] = {0.0,   -0.0,    0.5,     1.5,     2.5,    -2.5,
+                       0.125, 0.1,     -3.14159, 1e-7,   123.456, 1e15,
+                       1e22,  -1e300,  DBL_MAX, DBL_MIN, NAN,    -INFINITY,
+                       0.049999999999999996, 2.675};
+    for (size_t i = 0; i < sizeof(floats) / sizeof(*floats); i++)
+    {
+        for (int precision = 0; precision <= 17; precision++)
+        {
+            check_float(floats[i], precision);
+        }
+    }
+    uint32_t state = 3;
+    for (int i = 0; i < 100000; i++)
+    {
+        state = state * 1103515245 + 12345;
+        double value = ((int32_t)state) / (double)(1 << (state % 24));
+        check_float(value, state % 10);
+    }
+
+    // many appends stay linear, the terminator follows every one
+    builder = StringBuilder_create(0);
+    for (int i = 0; i < 10000; i++)
+    {
+        StringBuilder_append_int(&builder, i % 10);
+        assert(builder[Darray_length(builder)] == 0);
+    }
+    assert(Darray_length(builder) == 10000 && builder[9999] == '9');
+    Darray_destroy(builder);
+
+    printf("string builder tests passed\n");
+    return 0;
+}
@@ -0,0 +1,85 @@
+#include <assert.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#define DARRAY_INCLUDE_IMPLEMENTATION
+#include "../src/Darray.c"
+#include "../src/StructOfArrays.c"
+
+#define PARTICLE_FIELDS(FIELD)                                                 \
+    FIELD(float, x)                                                            \
+    FIELD(float, y)                                                            \
+    FIELD(double, mass)                                                        \
+    FIELD(uint8_t, flags)                                                      \
+    FIELD(uint32_t, id)
+STRUCT_OF_ARRAYS_DEFINE(Particles, PARTICLE_FIELDS)
+
+// every column is a Darray of the shared length in the shared capacity
+void check_columns(Particles *particles)
+{
+#define CHECK_COLUMN(type, field)                                              \
+    assert(Darray_length(particles->field) == particles->length);              \
+    assert(Darray_get_capacity(particles->field) == particles->capacity);      \
+    assert((uintptr_t)particles->field % STRUCT_OF_ARRAYS_ALIGNMENT == 0);
+    PARTICLE_FIELDS(CHECK_COLUMN)
+#undef CHECK_COLUMN
+    assert(particles->length < particles->capacity);
+}
+
+int main()
+{
+    Particles particles = Particles_create(2);
+    for (uint32_t i = 0; i < 1000; i++)
+    {
+        Particles_element particle = {
+            .x = i, .y = -(float)i, .mass = i * 0.5, .flags = i % 3, .id = i};
+        Particles_push(&particles, particle);
+        check_columns(&particles);
+    }
+    assert(particles.length == 1000);
+
+    // a pass over one column, the others stay untouched
+    float *x = StructOfArrays_column(&particles, x);
+    for (size_t i = 0; i < particles.length; i++)
+    {
+        x[i] += 1.0f;
+    }
+    Particles_element particle = Particles_get(&particles, 10);
+    assert(particle.x == 11.0f && particle.y == -10.0f);
+    assert(particle.mass == 5.0 && particle.flags == 1 && particle.id == 10);
+
+    // the last record takes the place of the removed one in every column
+    particle = Particles_swap_remove(&particles, 10);
+    assert(particle.id == 10);
+    particle = Particles_get(&particles, 10);
+    assert(particle.id == 999 && particle.x == 1000.0f);
+    assert(particle.y == -999.0f);
+    check_columns(&particles);
+
+    particle = Particles_pop(&particles);
+    assert(particle.id == 998 && particle.flags == 998 % 3);
+    assert(particles.length == 998);
+    check_columns(&particles);
+
+    particle.id = 7;
+    Particles_set(&particles, 0, particle);
+    assert(particles.id[0] == 7 && particles.mass[0] == 499.0);
+
+    // single columns are ordinary Darrays
+    double total;
+    Darray_sum(particles.mass, DARRAY_F64, &total);
+    assert(total > 0);
+
+    Particles_reserve(&particles, 5000);
+    assert(particles.capacity >= 5000);
+    check_columns(&particles);
+    Particles_destroy(&particles);
+
+    particles = Particles_create_allocator(0, malloc, realloc, free);
+    Particles_push(&particles, ((Particles_element){.id = 1}));
+    check_columns(&particles);
+    Particles_destroy(&particles);
+
+    printf("structure of arrays tests passed\n");
+    return 0;
+}